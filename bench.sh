@@ -0,0 +1,51 @@
+#!/bin/sh
+# Runs the benchmark suite against optimized binaries in $BENCH_DIR and compares the results with
+# a stored baseline. Called by make bench, which builds the binaries first.
+# Output: one "name value unit" line per benchmark in bench_output.txt. ns means lower is better,
+# per_s higher is better.
+# Environment:
+#   BENCH_DIR        directory with oss, child and ossbench (default bench_build)
+#   BENCH_BASELINE   baseline to compare against, or none to skip the comparison (default bench.baseline)
+#   BENCH_THRESHOLD  percent a result may get worse before it counts as a regression (default 20)
+#   BENCH_SCALE      passed to ossbench -x to shorten or lengthen the microbenchmarks (default 1)
+# Exits 1 if any benchmark regressed past the threshold. make bench-baseline runs the suite and
+# stores its output as the new baseline.
+
+BENCH_DIR=${BENCH_DIR:-bench_build}
+BENCH_BASELINE=${BENCH_BASELINE:-bench.baseline}
+BENCH_THRESHOLD=${BENCH_THRESHOLD:-20}
+BENCH_SCALE=${BENCH_SCALE:-1}
+OUTPUT=bench_output.txt
+
+"$BENCH_DIR/ossbench" -x "$BENCH_SCALE" > "$OUTPUT" || exit 1
+
+# end-to-end child lifecycles per second, best of three, at several concurrency levels; oss starts
+# ./child, so it runs from inside the build directory
+for s in 1 16 256; do
+  best=0
+  for run in 1 2 3; do
+    rate=$(cd "$BENCH_DIR" && ./oss -e -r 1 -s $s -c 2000 -t 120 -N /oss.bench.$$ -l /dev/null 2>&1 | sed -n 's/^OSS: Child lifecycles per second :: //p')
+    best=$(echo "$best ${rate:-0}" | awk '{print ($2 > $1) ? $2 : $1}')
+  done
+  echo "lifecycles_s$s $best per_s" >> "$OUTPUT"
+done
+
+cat "$OUTPUT"
+[ "$BENCH_BASELINE" = none ] && exit 0
+if [ ! -f "$BENCH_BASELINE" ]; then
+  echo "No baseline $BENCH_BASELINE; store one with make bench-baseline."
+  exit 0
+fi
+
+# a benchmark regresses when it is more than BENCH_THRESHOLD percent worse than the baseline
+awk -v threshold="$BENCH_THRESHOLD" '
+  FNR == NR { baseline[$1] = $2; next }
+  ($1 in baseline) && baseline[$1] > 0 {
+    change = ($2 - baseline[$1]) / baseline[$1] * 100
+    worse = ($3 == "per_s") ? -change : change
+    verdict = (worse > threshold) ? "REGRESSION" : "ok"
+    if(verdict == "REGRESSION") failed = 1
+    printf "%-28s %14.2f %14.2f %+8.1f%% %s\n", $1, baseline[$1], $2, change, verdict
+  }
+  END { exit failed }
+' "$BENCH_BASELINE" "$OUTPUT"
@@ -24,48 +24,50 @@
 
 #include "sharedmessage.h"
 #include "simulatedclock.h"
+#include "childtable.h"
+#include "childsim.h"
+#include "sharedregion.h"
+#include "placement.h"
 #include <signal.h>
+#include <ctype.h>
+#include <time.h>
 #include <errno.h>
-#include <semaphore.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/time.h>
-#include <sys/shm.h>
 
-static key_t sharedSemaphoreId;
-static key_t sharedMessageId;
-static key_t sharedClockId;
-static sem_t *semaphore;
-static sim_clock_t *simClock;
-static shared_message_t *message;
+static char *regionName;
+static int slotIndex;
+static int cpu = -2;  //-2 leaves the inherited affinity alone
+static shared_region_header_t *region;
 //static char logFilePath[] = "ChildSemaphoreUseLogFile.txt\0";
 //static FILE *logFile = NULL;
 
 static void printOptions(){
   fprintf(stderr, "CHILD:  Command Help\n");
   fprintf(stderr, "\tCHILD:  Optional '-h': Prints Command Usage\n");
-  fprintf(stderr, "\tCHILD:  '-m': Shared memory ID for shared message.\n");
-  fprintf(stderr, "\tCHILD:  '-s': Shared memory ID for semaphore.\n");
-  fprintf(stderr, "\tCHILD:  '-c': Shared memory ID for Operating System Simulator clock.\n");
+  fprintf(stderr, "\tCHILD:  '-r': Name of the shared memory region created by oss.\n");
+  fprintf(stderr, "\tCHILD:  '-i': Index of this child's slot in the slot table.\n");
+  fprintf(stderr, "\tCHILD:  Optional '-u': Cpu to pin to, or -1 to run on any cpu.\n");
 }
 
 static int parseOptions(int argc, char *argv[]){
   int c;
   int nCP = 0;
-  while ((c = getopt (argc, argv, "hm:s:c:")) != -1){
+  while ((c = getopt (argc, argv, "hr:i:u:")) != -1){
     switch (c){
       case 'h':
         printOptions();
         abort();
-      case 'c':
-        sharedClockId = atoi(optarg);
+      case 'r':
+        regionName = optarg;
         break;
-      case 's':
-        sharedSemaphoreId = atoi(optarg);
+      case 'i':
+        slotIndex = atoi(optarg);
         break;
-      case 'm':
-	sharedMessageId = atoi(optarg);
+      case 'u':
+        cpu = atoi(optarg);
         break;
       case '?':
 	if(isprint (optopt))
@@ -79,37 +81,8 @@ static int parseOptions(int argc, char *argv[]){
   return 0;
 }
 
-static int detachSharedSemaphore(){
-  return shmdt(semaphore);
-}
-
-static int detachSharedMessage(){
-  return shmdt(message);
-}
-
-static int detachSharedClock(){
-  return shmdt(simClock);
-}
-
-static int attachSharedSemaphore(){
-  if((semaphore = shmat(sharedSemaphoreId, NULL, 0)) == (void *)-1) return -1;
-  return 0;
-}
-
-static int attachSharedMessage(){
-  if((message = shmat(sharedMessageId, NULL, 0)) == (void *)-1) return -1;
-  return 0;
-}
-
-static int attachSharedClock(){
-  if((simClock = shmat(sharedClockId, NULL, SHM_RDONLY)) == (void *)-1) return -1;
-  return 0;
-}
-
 static void cleanUp(int signal){
-  if(detachSharedSemaphore() == -1) perror("CHILD: Failed to detach shared semaphore");
-  if(detachSharedMessage() == -1) perror("CHILD: Failed to detach shared message");
-  if(detachSharedClock() == -1) perror("CHILD: Failed to detach shared clock");
+  if(closeSharedRegion(region) == -1) perror("CHILD: Failed to unmap shared region");
   //if(logFile) fclose(logFile);
 }
 
@@ -145,43 +118,27 @@ int main(int argc, char **argv){
     perror("CHILD: Failed to init SIGINT watcher");
     exit(2);
   }
-  if(attachSharedSemaphore() == -1){
-    perror("CHILD: Failed to attach semaphore");
+  if(cpu != -2 && pinCurrentThread(cpu) == -1) perror("CHILD: Failed to set cpu affinity");
+  //one mapping holds the lock, clock, message queue, slots, statistics and log rings
+  if((region = openSharedRegion(regionName, 0)) == NULL){
+    perror("CHILD: Failed to attach shared region");
     exit(3);
   }
-  if(attachSharedMessage() == -1){
-    perror("CHILD: Failed to attach message");
-    exit(4);
-  }
-  if(attachSharedClock() == -1){
-    perror("CHILD: Failed to attach clock");
-    exit(5);
-  }
   
-  srand(time(0) + getpid()); 
-  int aliveTime = rand() % 1000001;  //range is 0-1,000,000 microseconds
-  sim_clock_t endTime;
-  addNanosecondsToSimClock(&endTime, simClock, aliveTime);  
-  //fprintf(stderr, "CHILD %d: Ends at time %d : %0d\n",getpid(), endTime.seconds, endTime.nanoseconds);
-
-  while(1){
-    int status;
-    fprintf(stderr, "CHILD %d: Waiting on semaphore\n", getpid());
-    if(sem_wait(semaphore) == -1) perror("CHILD");
-    fprintf(stderr, "CHILD %d: Acquired  semaphore\n", getpid());
-    int result;
-    if((result = compareSimClocks(simClock, &endTime)) != -1){  //clock is >= endTime
-      //try to terminate
-      if(messageEmpty(message)){  //message is clear
-        setMessage(simClock, message);
-        fprintf(stderr, "CHILD %d: Passing semaphore\n", getpid());
-        if(sem_post(semaphore) == -1) perror("CHILD");  //give up critical section
-        break;  //break from loop
-      }
-    }
-    fprintf(stderr, "CHILD %d: Passing semaphore\n", getpid());
-    if(sem_post(semaphore) == -1) perror("CHILD");
-  }
+  child_context_t context;
+  sim_stats_t *stats = SHARED_REGION_SECTION(region, statsOffset);
+  shared_child_slot_t *slots = SHARED_REGION_SECTION(region, slotsOffset);
+  unsigned int shard = slotIndex % region->shardCount;
+  context.lock = SHARED_REGION_SHARD(region, lock, shard);
+  context.lockNode = slotIndex;
+  context.simClock = SHARED_REGION_SHARD(region, clock, shard);
+  context.message = SHARED_REGION_SHARD(region, message, shard);
+  context.slot = &slots[slotIndex];
+  context.stats = &stats->children[slotIndex];
+  context.log = SHARED_REGION_SECTION(region, logOffset);
+  context.logRing = slotIndex;
+  context.id = getpid();
+  runChild(&context);
   //fprintf(stderr, "CHILD %d: Terminating\n", getpid());
   cleanUp(2);
 
@@ -0,0 +1,94 @@
+#include "childsim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+
+/*
+ * Stands in for the work a real critical section does: busy for nanoseconds of wall time.
+ */
+static void holdLock(unsigned long long nanoseconds){
+  unsigned long long until = monotonicNanoseconds() + nanoseconds;
+  while(nanoseconds && monotonicNanoseconds() < until);
+}
+
+/*
+ * Takes the lock once between deadlines, as the workload's gap asks, and works hold inside it.
+ */
+static void visitCriticalSection(child_context_t *context, unsigned long long *random){
+  sim_clock_t now = simClockNow(context->simClock);
+  logEvent(context->log, context->logRing, LOG_LEVEL_LOCK, LOG_CHILD_WAITING, context->id, now, 0);
+  if(simLockAcquire(context->lock, context->lockNode) == -1) perror("CHILD");
+  unsigned long long acquired = monotonicNanoseconds();
+  logEvent(context->log, context->logRing, LOG_LEVEL_LOCK, LOG_CHILD_ACQUIRED, context->id, now, 0);
+  holdLock(sampleDistribution(&context->slot->hold, random));
+  context->stats->holdNanoseconds += monotonicNanoseconds() - acquired;
+  if(simLockRelease(context->lock, context->lockNode) == -1) perror("CHILD");
+  logEvent(context->log, context->logRing, LOG_LEVEL_TRACE, LOG_CHILD_RELEASED, context->id, now, 0);
+}
+
+/*
+ * One simulated lifetime: publish the end time oss picked, visit the critical section every gap
+ * until then, and report the termination.
+ */
+static void liveLifetime(child_context_t *context){
+  sim_clock_t aliveTime = context->slot->aliveTime;  //oss derives it from the run's seed
+  unsigned long long random = context->slot->random;
+  sim_clock_t visit;
+  sim_clock_t now = simClockNow(context->simClock);
+  sim_clock_t endTime = addNanosecondsToSimClock(now, aliveTime);
+  //publish the deadline so oss can jump straight to it in discrete-event mode
+  shared_message_t deadline;
+  setMessage(MESSAGE_DEADLINE, context->id, endTime, &deadline);
+  while(enqueueMessage(context->message, &deadline) == -1){
+    context->stats->queueRetries++;
+    sched_yield();
+  }
+  context->stats->messagesSent++;
+  //fprintf(stderr, "CHILD %d: Ends at time %d : %0d\n",context->id, simClockSeconds(endTime), simClockNanoseconds(endTime));
+
+  //sleep until each visit and then endTime instead of polling the clock
+  while(context->slot->gap.kind != DISTRIBUTION_NONE){
+    visit = addNanosecondsToSimClock(simClockNow(context->simClock), sampleDistribution(&context->slot->gap, &random));
+    if(visit >= endTime) break;
+    simClockWaitUntil(context->simClock, visit);
+    visitCriticalSection(context, &random);
+  }
+  simClockWaitUntil(context->simClock, endTime);
+  while(1){
+    now = simClockNow(context->simClock);
+    logEvent(context->log, context->logRing, LOG_LEVEL_LOCK, LOG_CHILD_WAITING, context->id, now, 0);
+    if(simLockAcquire(context->lock, context->lockNode) == -1) perror("CHILD");
+    unsigned long long acquired = monotonicNanoseconds();
+    //only fixed-size records are copied while the lock is held; osslogdump formats them later
+    shared_message_t termination;
+    now = simClockNow(context->simClock);
+    logEvent(context->log, context->logRing, LOG_LEVEL_LOCK, LOG_CHILD_ACQUIRED, context->id, now, 0);
+    setMessage(MESSAGE_TERMINATION, context->id, now, &termination);
+    int sent = enqueueMessage(context->message, &termination);
+    holdLock(sampleDistribution(&context->slot->hold, &random));
+    logEvent(context->log, context->logRing, LOG_LEVEL_LOCK, LOG_CHILD_PASSING, context->id, now, 0);
+    context->stats->holdNanoseconds += monotonicNanoseconds() - acquired;
+    if(simLockRelease(context->lock, context->lockNode) == -1) perror("CHILD");  //give up critical section
+    logEvent(context->log, context->logRing, LOG_LEVEL_TRACE, LOG_CHILD_RELEASED, context->id, now, 0);
+    if(sent == 0){
+      context->stats->messagesSent++;
+      break;  //break from loop
+    }
+    context->stats->queueRetries++;
+    sched_yield();  //queue is full; let oss drain it
+  }
+}
+
+/*
+ * Lives one lifetime, or in pooled mode lifetime after lifetime until oss tells the child to exit.
+ */
+void runChild(child_context_t *context){
+  unsigned int lifetime = context->slot->lifetime;
+  while(1){
+    liveLifetime(context);
+    if(!context->slot->pooled) break;
+    lifetime = awaitChildLifetime(context->slot, lifetime);
+    if(context->slot->exit) break;
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef CHILDSIM_H
+#define CHILDSIM_H
+
+#include "simulatedclock.h"
+#include "sharedmessage.h"
+#include "childtable.h"
+#include "simlock.h"
+#include "sharedstats.h"
+#include "sharedlog.h"
+#include <sys/types.h>
+
+/*
+ * Everything one simulated child needs. The child process builds this from its attached segments;
+ * the threaded backend of oss builds one per thread from its own pointers.
+ */
+typedef struct{
+  sim_lock_t *lock;
+  unsigned int lockNode;  //this child's node in the lock; its slot index
+  shared_clock_t *simClock;
+  shared_message_queue_t *message;
+  shared_child_slot_t *slot;
+  sim_child_stats_t *stats;
+  shared_log_t *log;
+  unsigned int logRing;   //this child's ring in the log; its slot index
+  pid_t id;            //pid of the child process, or the id oss assigned to a child thread
+}child_context_t;
+
+void runChild(child_context_t *context);
+
+#endif
@@ -0,0 +1,138 @@
+#include "childtable.h"
+#include "futex.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+
+
+static unsigned int hashPid(child_table_t *table, pid_t pid){
+  return ((unsigned int)pid * 2654435761u) & table->hashMask;
+}
+
+int initChildTable(child_table_t *table, unsigned int capacity){
+  unsigned int i;
+  unsigned int hashSize = 2;
+  while(hashSize < capacity * 2) hashSize <<= 1;  //keep the load factor at or below one half
+  table->capacity = capacity;
+  table->used = 0;
+  table->hashMask = hashSize - 1;
+  table->entries = malloc(sizeof(child_entry_t) * capacity);
+  table->freeSlots = malloc(sizeof(int) * capacity);
+  table->hashPids = malloc(sizeof(pid_t) * hashSize);
+  table->hashSlots = malloc(sizeof(int) * hashSize);
+  if(!table->entries || !table->freeSlots || !table->hashPids || !table->hashSlots){
+    freeChildTable(table);
+    return -1;
+  }
+  for(i = 0; i < capacity; i++){
+    table->entries[i].pid = -1;
+    table->entries[i].state = SLOT_FREE;
+    table->freeSlots[i] = capacity - 1 - i;  //hand out low slots first
+  }
+  table->freeCount = capacity;
+  for(i = 0; i < hashSize; i++) table->hashPids[i] = 0;
+  return 0;
+}
+
+void freeChildTable(child_table_t *table){
+  free(table->entries);
+  free(table->freeSlots);
+  free(table->hashPids);
+  free(table->hashSlots);
+  table->entries = NULL;
+  table->freeSlots = NULL;
+  table->hashPids = NULL;
+  table->hashSlots = NULL;
+}
+
+int acquireChildSlot(child_table_t *table){
+  if(table->freeCount == 0) return -1;
+  return table->freeSlots[--table->freeCount];
+}
+
+void releaseChildSlot(child_table_t *table, int slot){
+  table->entries[slot].pid = -1;
+  table->entries[slot].state = SLOT_FREE;
+  table->freeSlots[table->freeCount++] = slot;
+}
+
+int addChild(child_table_t *table, int slot, pid_t pid){
+  unsigned int i = hashPid(table, pid);
+  while(table->hashPids[i] != 0){
+    if(table->hashPids[i] == pid) return -1;
+    i = (i + 1) & table->hashMask;
+  }
+  table->hashPids[i] = pid;
+  table->hashSlots[i] = slot;
+  table->entries[slot].pid = pid;
+  table->entries[slot].state = SLOT_STARTING;
+  table->used++;
+  return 0;
+}
+
+int findChildSlot(child_table_t *table, pid_t pid){
+  unsigned int i = hashPid(table, pid);
+  while(table->hashPids[i] != 0){
+    if(table->hashPids[i] == pid) return table->hashSlots[i];
+    i = (i + 1) & table->hashMask;
+  }
+  return -1;
+}
+
+/*
+ * Removes pid from the hash with backward-shift deletion (no tombstones) and returns its slot.
+ * The slot itself stays allocated until releaseChildSlot.
+ */
+int removeChild(child_table_t *table, pid_t pid){
+  unsigned int i = hashPid(table, pid);
+  unsigned int j;
+  int slot;
+  while(table->hashPids[i] != pid){
+    if(table->hashPids[i] == 0) return -1;
+    i = (i + 1) & table->hashMask;
+  }
+  slot = table->hashSlots[i];
+  j = i;
+  while(1){
+    j = (j + 1) & table->hashMask;
+    if(table->hashPids[j] == 0) break;
+    unsigned int home = hashPid(table, table->hashPids[j]);
+    //move j back into the hole at i unless its home lies cyclically in (i, j]
+    if((i <= j) ? (i < home && home <= j) : (i < home || home <= j)) continue;
+    table->hashPids[i] = table->hashPids[j];
+    table->hashSlots[i] = table->hashSlots[j];
+    i = j;
+  }
+  table->hashPids[i] = 0;
+  table->used--;
+  return slot;
+}
+
+void resetSharedChildSlot(shared_child_slot_t *slot, int pooled){
+  slot->aliveTime = 0;
+  slot->lifetime = 0;
+  slot->pooled = pooled;
+  slot->exit = 0;
+}
+
+void assignChildLifetime(shared_child_slot_t *slot, sim_clock_t aliveTime){
+  slot->aliveTime = aliveTime;
+  __atomic_add_fetch(&slot->lifetime, 1, __ATOMIC_SEQ_CST);
+  futexWake(&slot->lifetime, 1);
+}
+
+void signalChildExit(shared_child_slot_t *slot){
+  slot->exit = 1;
+  assignChildLifetime(slot, 0);
+}
+
+/*
+ * Sleeps until oss hands out a lifetime newer than current and returns it.
+ */
+unsigned int awaitChildLifetime(shared_child_slot_t *slot, unsigned int current){
+  unsigned int next;
+  while((next = __atomic_load_n(&slot->lifetime, __ATOMIC_SEQ_CST)) == current){
+    if(futexWait(&slot->lifetime, current, NULL) == -1 && errno != EAGAIN && errno != EINTR) perror("Failed to wait for a new lifetime");
+  }
+  return next;
+}
@@ -0,0 +1,74 @@
+#ifndef CHILDTABLE_H
+#define CHILDTABLE_H
+
+#include "simulatedclock.h"
+#include "workload.h"
+#include <sys/types.h>
+
+#define SLOT_FREE 0
+#define SLOT_STARTING 1   //spawned, deadline not yet published
+#define SLOT_WAITING 2    //deadline published and pending
+#define SLOT_DUE 3        //deadline reached, termination message not yet read
+#define SLOT_REPORTED 4   //termination message read, waiting to be reaped
+
+typedef struct{
+  pid_t pid;
+  int state;
+  unsigned long long spawnedAt;   //monotonic ns the current lifetime was started
+  unsigned long long reportedAt;  //monotonic ns the termination message was sent
+}child_entry_t;
+
+/*
+ * Per-child state shared with the child through the slot segment, one cache line per slot.
+ * In pooled mode a child sleeps on lifetime between lifetimes; oss bumps it to hand out a new one.
+ * oss writes aliveTime, how long the coming lifetime lasts, and the child's workload class before
+ * starting or waking the child; random seeds the child's own hold and gap draws.
+ */
+typedef struct{
+  volatile sim_clock_t aliveTime;
+  unsigned long long random;
+  distribution_t hold;
+  distribution_t gap;
+  volatile unsigned int lifetime;
+  volatile int pooled;
+  volatile int exit;
+}__attribute__((aligned(CACHE_LINE_SIZE))) shared_child_slot_t;
+
+/*
+ * oss-private table of child slots. Slots are handed out from a free list and pids are mapped
+ * back to their slot through an open-addressed hash, so spawn, lookup and reap are all O(1).
+ */
+typedef struct{
+  unsigned int capacity;
+  unsigned int used;
+  child_entry_t *entries;
+  int *freeSlots;
+  unsigned int freeCount;
+  pid_t *hashPids;
+  int *hashSlots;
+  unsigned int hashMask;
+}child_table_t;
+
+int initChildTable(child_table_t *table, unsigned int capacity);
+
+void freeChildTable(child_table_t *table);
+
+int acquireChildSlot(child_table_t *table);
+
+void releaseChildSlot(child_table_t *table, int slot);
+
+int addChild(child_table_t *table, int slot, pid_t pid);
+
+int findChildSlot(child_table_t *table, pid_t pid);
+
+int removeChild(child_table_t *table, pid_t pid);
+
+void resetSharedChildSlot(shared_child_slot_t *slot, int pooled);
+
+void assignChildLifetime(shared_child_slot_t *slot, sim_clock_t aliveTime);
+
+void signalChildExit(shared_child_slot_t *slot);
+
+unsigned int awaitChildLifetime(shared_child_slot_t *slot, unsigned int current);
+
+#endif
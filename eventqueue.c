@@ -0,0 +1,67 @@
+#include "eventqueue.h"
+#include <stdlib.h>
+
+
+static void swapEvents(event_t *a, event_t *b){
+  event_t temp = *a;
+  *a = *b;
+  *b = temp;
+}
+
+static int earlier(event_t *a, event_t *b){
+  return compareSimClocks(a->time, b->time) == -1;
+}
+
+int initEventQueue(event_queue_t *queue, unsigned int capacity){
+  queue->size = 0;
+  queue->capacity = capacity ? capacity : 1;
+  if((queue->events = malloc(sizeof(event_t) * queue->capacity)) == NULL) return -1;
+  return 0;
+}
+
+void freeEventQueue(event_queue_t *queue){
+  free(queue->events);
+  queue->events = NULL;
+  queue->size = queue->capacity = 0;
+}
+
+int pushEvent(event_queue_t *queue, sim_clock_t time, pid_t pid){
+  unsigned int i;
+  if(queue->size == queue->capacity){
+    event_t *grown = realloc(queue->events, sizeof(event_t) * queue->capacity * 2);
+    if(grown == NULL) return -1;
+    queue->events = grown;
+    queue->capacity *= 2;
+  }
+  i = queue->size++;
+  queue->events[i].time = time;
+  queue->events[i].pid = pid;
+  while(i > 0 && earlier(&queue->events[i], &queue->events[(i - 1) / 2])){  //sift up
+    swapEvents(&queue->events[i], &queue->events[(i - 1) / 2]);
+    i = (i - 1) / 2;
+  }
+  return 0;
+}
+
+event_t *peekEvent(event_queue_t *queue){
+  if(queue->size == 0) return NULL;
+  return &queue->events[0];
+}
+
+int popEvent(event_queue_t *queue, event_t *event){
+  unsigned int i = 0;
+  if(queue->size == 0) return 0;
+  if(event) *event = queue->events[0];
+  queue->events[0] = queue->events[--queue->size];
+  while(1){  //sift down
+    unsigned int smallest = i;
+    unsigned int left = 2 * i + 1;
+    unsigned int right = left + 1;
+    if(left < queue->size && earlier(&queue->events[left], &queue->events[smallest])) smallest = left;
+    if(right < queue->size && earlier(&queue->events[right], &queue->events[smallest])) smallest = right;
+    if(smallest == i) break;
+    swapEvents(&queue->events[i], &queue->events[smallest]);
+    i = smallest;
+  }
+  return 1;
+}
@@ -0,0 +1,31 @@
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include "simulatedclock.h"
+#include <sys/types.h>
+
+typedef struct{
+  sim_clock_t time;
+  pid_t pid;
+}event_t;
+
+/*
+ * Binary min-heap of pending child deadlines, ordered by simulated time. Private to oss.
+ */
+typedef struct{
+  unsigned int size;
+  unsigned int capacity;
+  event_t *events;
+}event_queue_t;
+
+int initEventQueue(event_queue_t *queue, unsigned int capacity);
+
+void freeEventQueue(event_queue_t *queue);
+
+int pushEvent(event_queue_t *queue, sim_clock_t time, pid_t pid);
+
+event_t *peekEvent(event_queue_t *queue);
+
+int popEvent(event_queue_t *queue, event_t *event);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+
+/*
+ * Thin wrappers around the futex syscall. The words live in memory shared between processes, so these use the
+ * shared (non-private) operations. timeout is relative and may be NULL.
+ */
+static inline int futexWait(volatile unsigned int *address, unsigned int value, const struct timespec *timeout){
+  return syscall(SYS_futex, address, FUTEX_WAIT, value, timeout, NULL, 0);
+}
+
+static inline int futexWake(volatile unsigned int *address, int count){
+  return syscall(SYS_futex, address, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+#endif
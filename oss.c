@@ -25,58 +25,234 @@
  *
  */
 
+#define _GNU_SOURCE  //pthread_setaffinity_np
 #include "sharedmessage.h"
 #include "simulatedclock.h"
+#include "eventqueue.h"
+#include "childtable.h"
+#include "childsim.h"
+#include "simlock.h"
+#include "sharedstats.h"
+#include "sharedlog.h"
+#include "sharedregion.h"
+#include "placement.h"
+#include "workload.h"
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <spawn.h>
+#include <signal.h>
 #include <sys/wait.h>
-#include <sys/shm.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
 #include <unistd.h>
-#include <semaphore.h>
 #include <errno.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <limits.h>
+#include <stdint.h>
+#include "futex.h"
+#ifdef OSS_THREADED
+#define LOCK_PSHARED 0  //children are threads of this process
+#else
+#define LOCK_PSHARED 1
+#endif
 
 static unsigned int maxProcessTime = 20;
-static char defaultLogFilePath[] = "logfile.txt";
+static char defaultLogFilePath[] = "logfile.bin";
 static char *logFilePath = NULL;
 static FILE *logFile;
+static int logLevel = LOG_LEVEL_TERMINATIONS;
+static shared_log_t *sharedLog;
+static log_writer_t logWriter;
 static unsigned int maxChildProcesses = 100;
 static unsigned int numConcurrentProcesses = 5;
-static shared_message_t *message;
-static sem_t *semaphore;
-static sim_clock_t *simClock;
-static key_t clockSharedMemoryKey;
-static key_t messageSharedMemoryKey;
-static key_t semaphoreSharedMemoryKey;
-static int semaphoreSharedMemoryId;
-static int messageSharedMemoryId;
-static int clockSharedMemoryId;
-static pid_t *children;
+static unsigned int messageQueueCapacity = 0;
+static int lockType = LOCK_SEM;
+static char regionName[64];
+static shared_region_header_t *region;
+static int hugePages = 0;
+static placement_t placement;
+static shared_child_slot_t *slots;
+static sim_stats_t *stats;
+static int pooledMode = 0;
+extern char **environ;
+static child_table_t children;
+static int *lingeringSlots = NULL;  //retired slots whose lock node still stands in line for a dead child
+static unsigned int lingeringCount = 0;
 static int childCounter = 0;
+static int completedLifetimes = 0;
+static struct timespec startTime;
+static int childEventFd = -1;
+static int epollFd = -1;
+static sigset_t originalSignalMask;
+static pid_t childGroup = 0;  //process group every live child is in, so shutdown signals them all at once
+static int gracefulDrain = 0;  //-D: handle queued messages before stopping children and after reaping them
+static unsigned long long termGrace = 100;  //ms children get to exit on SIGTERM before SIGKILL
+#define SHUTDOWN_KILL_WAIT 1000  //ms to wait for SIGKILLed children before giving up on them
+static unsigned int pendingReaps = 0;  //children whose termination was read but who have not been reaped
+static int reapBacklog = 0;  //the last reap stopped at REAP_BATCH with exits possibly left over
+#define REAP_BATCH 64  //exits handled per reap, so a steady stream of them cannot keep oss from its loop
+static int discreteEventMode = 0;
+static double timeScale = 0;  //-T: simulated ns per real ns; 0 means oss ticks the clock
+static unsigned long long seed;  //with the spawn count, determines every child lifetime
+static int seedSet = 0;
+static sim_clock_t *replayAliveTimes = NULL;  //-R: lifetimes read back from a trace, in spawn order
+static unsigned int replayCount = 0;
+static workload_t workload;
 
-// Finds a childpid in the child pid list and returns its index
-static int findId(pid_t childpid){
-  int i;
-  for(i = 0; i < numConcurrentProcesses; i++){
-    if(children[i] == childpid) return i;
-  }
-  return -1;
-}
+/*
+ * -A: AIMD control of how many children live at once, between 1 and -s. Every window the
+ * controller compares completed lifetimes per second and mean lock wait with the previous window:
+ * the limit doubles (slow start) or grows by one while that pays, and shrinks to three quarters
+ * once a step up costs throughput or only adds lock wait. A step is only taken when two windows
+ * in a row call for it, and the window straddling a change is skipped, so one noisy sample
+ * cannot move the limit.
+ */
+#define CONTROL_TOLERANCE 0.05     //throughput changes smaller than this are noise
+#define CONTROL_WAIT_GROWTH 1.5    //mean lock wait growing by this much counts as contention
+static unsigned int concurrencyLimit;
+static unsigned int controlWindow = 0;  //ms; 0 leaves the limit at -s
+typedef struct{
+  unsigned long long time;
+  unsigned long long lifetimes;
+  unsigned long long acquisitions;
+  unsigned long long waitNanoseconds;
+  double throughput;
+  double wait;
+  int lastStep;         //+1 after a raise, -1 after a cut
+  int pendingStep;      //what the previous window called for and did not get: +1 raise, -1 cut
+  int settling;         //the window after a change runs across it and is not judged
+  int slowStart;
+  unsigned int decisions;
+  double bestThroughput;
+  unsigned int bestLimit;
+}concurrency_control_t;
+static concurrency_control_t control;
+static unsigned int classChildren[WORKLOAD_MAX_CLASSES];  //children started with each workload class
+
+/*
+ * One independent simulation: a clock, the lock and message queue its children use, and the
+ * deadline bookkeeping for them. Slot i belongs to shard i % shardCount.
+ */
+typedef struct{
+  unsigned int index;
+  shared_clock_t *simClock;
+  sim_lock_t *lock;
+  shared_message_queue_t *message;
+  event_queue_t deadlines;
+  unsigned int unpublishedChildren;  //children that have not yet sent their deadline
+  unsigned int dueChildren;  //children whose deadline has passed but whose termination is not yet read
+  unsigned int reportedChildren;  //children whose termination was read but who have not been reaped
+  unsigned long long ticks;  //clock advances not yet added to stats->clockTicks
+  int epollFd;  //what an idle pass waits on under -I event
+  pthread_t thread;
+}shard_t;
+
+static shard_t *shards;
+static unsigned int shardCount = 1;
+static sim_clock_t simulationEnd = 2 * SIM_CLOCK_SECOND;  //oss stops once every shard clock reaches this
+static sim_clock_t barrierInterval = 1000000;  //simulated nanoseconds between shard barriers
+static volatile unsigned int barrierArrivals = 0;
+static volatile unsigned int barrierGeneration = 0;
+static unsigned int barriersPassed = 0;
+static unsigned int finishedShards = 0;
+static volatile sig_atomic_t stopSignal = 0;  //set by the signal handler; the loops stop and main tears down
+static pthread_mutex_t bookkeeping = PTHREAD_MUTEX_INITIALIZER;  //child table, counters and oss log ring; shared by shard threads and the reaper
+#define SHARD_OF(slot) (&shards[(slot) % shardCount])
+
+#define IDLE_SPIN 0   //poll flat out
+#define IDLE_YIELD 1  //after a short spin, sched_yield on every idle pass
+#define IDLE_PARK 2   //after a short spin, sleep on the message queue with exponential backoff
+#define IDLE_EVENT 3  //after a short spin, wait in epoll on the queue's eventfd, SIGCHLD and the run timer
+#define IDLE_SPIN_PASSES 64
+#define IDLE_MIN_BACKOFF 1000      //ns
+#define IDLE_MAX_BACKOFF 1000000   //ns; bounds how late an unannounced reap is noticed while parked
+#define IDLE_EVENT_TIMEOUT 10      //ms; every source is notified, this only bounds how late a stop is seen
+static int idlePolicy = IDLE_SPIN;
+static int idlePolicySet = 0;
+static const char *idlePolicyNames[] = {"spin", "yield", "park", "event"};
+static unsigned long long loopCpuNanoseconds = 0;   //cpu time of the oss loops, summed over shards
+static unsigned long long loopWallNanoseconds = 0;
+static int timerFd = -1;  //run-time limit under -I event, in place of alarm()
+#ifdef OSS_THREADED
+static pthread_t *childThreads;
+static shared_message_queue_t *exitedChildren;  //ids of child threads that have returned and can be joined
+static pid_t nextChildThreadId = 1;
+#endif
 
 static void printOptions(){
   fprintf(stderr, "OSS:  Command Help\n");
   fprintf(stderr, "\tOSS:  '-h': Prints Command Usage\n");
-  fprintf(stderr, "\tOSS:  Optional '-l': Filename of log file. Default is logfile.txt\n");
+  fprintf(stderr, "\tOSS:  Optional '-l': Filename of binary log file, read it with osslogdump. Default is logfile.bin\n");
+  fprintf(stderr, "\tOSS:  Optional '-v': Log verbosity: 0 off, 1 terminations, 2 also child lock events, 3 full event trace. Default is 1.\n");
   fprintf(stderr, "\tOSS:  Optional '-t': Input number of seconds before the main process terminates. Default is 20 seconds.\n");
   fprintf(stderr, "\tOSS:  Optional '-c': Input maximum number of child processes to create. Default is 100 child processes.\n");
-  fprintf(stderr, "\tOSS:  Optional '-s': Input number of concurrent child processes. Default is 5, cannot exceed 19.\n");
+  fprintf(stderr, "\tOSS:  Optional '-s': Input number of concurrent child processes. Default is 5, limited only by RLIMIT_NPROC.\n");
+  fprintf(stderr, "\tOSS:  Optional '-e': Discrete-event mode. Advance the clock straight to the next child deadline instead of ticking.\n");
+  fprintf(stderr, "\tOSS:  Optional '-T': Scaled-time mode. Simulated time runs at this many times CLOCK_MONOTONIC, with no tick loop.\n");
+  fprintf(stderr, "\tOSS:  Optional '-p': Pooled mode. Children are started once and given a new lifetime instead of exiting.\n");
+  fprintf(stderr, "\tOSS:  Optional '-L': Critical section lock: sem, sysvsem, futex, ticket, mcs or robust-mutex. Default is sem.\n");
+  fprintf(stderr, "\tOSS:  Optional '-q': Capacity of each shard's message queue. Default is twice the concurrent child processes per shard.\n");
+  fprintf(stderr, "\tOSS:  Optional '-r': Seed child lifetimes are derived from. Default is time and pid; printed at shutdown.\n");
+  fprintf(stderr, "\tOSS:  Optional '-R': Replay the child lifetimes of a trace recorded with -v 3. Replaces -c and -r.\n");
+  fprintf(stderr, "\tOSS:  Optional '-W': Add a child class, e.g. life=exp:200000,hold=fixed:2000,gap=uniform:10000:50000,weight=3.\n");
+  fprintf(stderr, "\tOSS:  Optional '-w': Read child classes from a file, one per line in the -W form.\n");
+  fprintf(stderr, "\tOSS:  Optional '-D': Graceful drain. At shutdown handle every queued message first, and give children this many ms to exit on SIGTERM before SIGKILL (default 100).\n");
+  fprintf(stderr, "\tOSS:  Optional '-A': Adapt the number of live children, up to -s, every this many milliseconds of lock wait and throughput.\n");
+  fprintf(stderr, "\tOSS:  Optional '-S': Number of shards, each with its own clock, lock, message queue and pinned oss thread. Default is 1.\n");
+  fprintf(stderr, "\tOSS:  Optional '-B': Simulated nanoseconds between the barriers that keep shard clocks together. Default is 1000000.\n");
+  fprintf(stderr, "\tOSS:  Optional '-I': Idle policy when a pass makes no progress, with -e or -T: spin, yield, park or event. Default is spin.\n");
+  fprintf(stderr, "\tOSS:  Optional '-o': Pin oss to this cpu. Shard threads take the cpus after it.\n");
+  fprintf(stderr, "\tOSS:  Optional '-C': Pin children to this cpu list, e.g. 2-5,8.\n");
+  fprintf(stderr, "\tOSS:  Optional '-M': How children are spread over the -C list: rr (round-robin by slot) or compact. Default is rr.\n");
+  fprintf(stderr, "\tOSS:  Optional '-P': Scheduling policy for oss and children: other, batch or fifo[:priority]. Default is other.\n");
+  fprintf(stderr, "\tOSS:  Optional '-n': Nice level for oss and children.\n");
+  fprintf(stderr, "\tOSS:  Optional '-N': Name of the shared memory region passed to children. Default is /oss.<uid>.\n");
+  fprintf(stderr, "\tOSS:  Optional '-H': Ask for the shared memory region to be backed by transparent huge pages.\n");
+}
+
+/*
+ * Reads the spawn records of a trace so this run hands out the same lifetimes in the same order.
+ */
+static int loadReplay(const char *path){
+  FILE *file;
+  log_file_header_t header;
+  log_record_t record;
+  unsigned int capacity = 1024;
+  if((file = openLogFile(path, &header)) == NULL){
+    if(errno == EINVAL) fprintf(stderr, "OSS: %s is not a log file from this version of oss.\n", path);
+    else perror("OSS: Failed to open trace");
+    return -1;
+  }
+  if((replayAliveTimes = malloc(sizeof(sim_clock_t) * capacity)) == NULL) return -1;
+  while(fread(&record, sizeof(record), 1, file) == 1){
+    if(record.type != LOG_MASTER_SPAWN) continue;
+    if(replayCount == capacity && (replayAliveTimes = realloc(replayAliveTimes, sizeof(sim_clock_t) * (capacity *= 2))) == NULL) return -1;
+    replayAliveTimes[replayCount++] = record.argument;
+  }
+  fclose(file);
+  if(replayCount == 0){
+    fprintf(stderr, "OSS: %s has no spawn records; record it with -v 3.\n", path);
+    return -1;
+  }
+  seed = header.seed;
+  seedSet = 1;
+  return 0;
 }
 
 static int parseOptions(int argc, char *argv[]){
   int c;
   int nCP = 0;
-  while ((c = getopt (argc, argv, "ht:c:s:l:")) != -1){
+  initPlacement(&placement);
+  initWorkload(&workload);
+  while ((c = getopt (argc, argv, "ht:c:s:l:q:epL:v:N:HS:B:o:C:M:P:n:I:r:R:W:w:A:T:D:")) != -1){
     switch (c){
       case 'h':
         printOptions();
@@ -91,6 +267,98 @@ static int parseOptions(int argc, char *argv[]){
       case 'c':
         maxChildProcesses = atoi(optarg);
         break;
+      case 'e':
+        discreteEventMode = 1;
+        break;
+      case 'T':
+        timeScale = atof(optarg);
+        break;
+      case 'p':
+        pooledMode = 1;
+        break;
+      case 'L':
+        if((lockType = simLockType(optarg)) == -1){
+          fprintf(stderr, "OSS: Unknown lock type `%s'.\n", optarg);
+          abort();
+        }
+        break;
+      case 'q':
+        messageQueueCapacity = atoi(optarg);
+        break;
+      case 'v':
+        logLevel = atoi(optarg);
+        break;
+      case 'N':
+        snprintf(regionName, sizeof(regionName), "%s", optarg);
+        break;
+      case 'H':
+        hugePages = 1;
+        break;
+      case 'S':
+        shardCount = atoi(optarg);
+        break;
+      case 'B':
+        barrierInterval = strtoull(optarg, NULL, 10);
+        break;
+      case 'o':
+        placement.ossCpu = atoi(optarg);
+        break;
+      case 'C':
+        if(parseCpuList(&placement, optarg) == -1){
+          fprintf(stderr, "OSS: Bad cpu list `%s'.\n", optarg);
+          abort();
+        }
+        break;
+      case 'M':
+        if(parsePlacementMode(&placement, optarg) == -1){
+          fprintf(stderr, "OSS: Unknown placement `%s'.\n", optarg);
+          abort();
+        }
+        break;
+      case 'P':
+        if(parseSchedulingPolicy(&placement, optarg) == -1){
+          fprintf(stderr, "OSS: Unknown scheduling policy `%s'.\n", optarg);
+          abort();
+        }
+        break;
+      case 'n':
+        placement.nice = atoi(optarg);
+        placement.niceSet = 1;
+        break;
+      case 'r':
+        seed = strtoull(optarg, NULL, 10);
+        seedSet = 1;
+        break;
+      case 'R':
+        if(loadReplay(optarg) == -1) abort();
+        break;
+      case 'A':
+        controlWindow = atoi(optarg);
+        break;
+      case 'D':
+        gracefulDrain = 1;
+        termGrace = strtoull(optarg, NULL, 10);
+        break;
+      case 'W':
+        if(parseWorkloadClass(&workload, optarg) == -1){
+          fprintf(stderr, "OSS: Bad workload class `%s'.\n", optarg);
+          abort();
+        }
+        break;
+      case 'w':
+        if(loadWorkloadFile(&workload, optarg) == -1){
+          perror("OSS: Failed to load workload file");
+          abort();
+        }
+        break;
+      case 'I':
+        for(idlePolicy = IDLE_EVENT; idlePolicy >= 0 && strcmp(optarg, idlePolicyNames[idlePolicy]); idlePolicy--);
+        if(idlePolicy == -1){
+          fprintf(stderr, "OSS: Unknown idle policy `%s'.\n", optarg);
+          abort();
+        }
+        idlePolicySet = 1;
+        break;
       case 'l':
 	logFilePath = malloc(sizeof(char) * (strlen(optarg) + 1));
         memcpy(logFilePath, optarg, strlen(optarg));
@@ -109,15 +377,42 @@ static int parseOptions(int argc, char *argv[]){
 	  abort();
     }
   }
-  //if(!nCP) maxChildProcesses < 20 ? numConcurrentProcesses = maxChildProcesses : 19;
-  if(nCP && (numConcurrentProcesses > 19)){
-    fprintf(stderr, "OSS: Cannot have more than 19 concurrent child processes.\n"); 
+  //the slot table is sized at runtime, so the only ceiling is how many processes this user may run
+  struct rlimit processLimit;
+  if(nCP && (numConcurrentProcesses < 1 || (getrlimit(RLIMIT_NPROC, &processLimit) == 0 && processLimit.rlim_cur != RLIM_INFINITY && numConcurrentProcesses >= processLimit.rlim_cur))){
+    fprintf(stderr, "OSS: Concurrent child processes must be at least 1 and below the RLIMIT_NPROC limit.\n"); 
     fprintf(stderr, "OSS: Cleaning up...");
     free(logFilePath);
     fprintf(stderr, "Aborting\n");
     abort(); 
   }
   
+  if(shardCount < 1 || shardCount > numConcurrentProcesses || barrierInterval == 0){
+    fprintf(stderr, "OSS: Shards must be between 1 and the number of concurrent child processes, with a nonzero barrier interval.\n");
+    abort();
+  }
+
+  if(timeScale < 0 || (timeScale > 0 && discreteEventMode)){
+    fprintf(stderr, "OSS: The time scale must be positive and cannot be combined with -e.\n");
+    abort();
+  }
+  //nothing ticks a scaled clock, so by default an idle oss sleeps until a message or exit wakes it
+  if(timeScale > 0 && !idlePolicySet) idlePolicy = IDLE_EVENT;
+  //every tick is progress, so the tick loop never idles and a sleeping policy would have nothing to do
+  if(idlePolicy != IDLE_SPIN && !discreteEventMode && !timeScale){
+    fprintf(stderr, "OSS: -I %s only applies with -e or -T; the tick loop spins.\n", idlePolicyNames[idlePolicy]);
+    idlePolicy = IDLE_SPIN;
+  }
+
+  //each child has at most a deadline and a termination outstanding in its shard's queue
+  if(!messageQueueCapacity) messageQueueCapacity = (numConcurrentProcesses + shardCount - 1) / shardCount * 2;
+
+  if(!regionName[0]) defaultSharedRegionName(regionName, sizeof(regionName));
+  finishWorkload(&workload);
+  if(!seedSet) seed = (unsigned long long)time(0) << 32 ^ getpid();
+  if(replayCount) maxChildProcesses = replayCount;  //the trace ends where the recorded run stopped spawning
+  concurrencyLimit = controlWindow ? 1 : numConcurrentProcesses;  //the controller starts low and climbs
+
   if(!logFilePath){
     logFilePath = malloc(sizeof(char) * strlen(defaultLogFilePath) + 1);
     memcpy(logFilePath, defaultLogFilePath, strlen(defaultLogFilePath));
@@ -127,245 +422,876 @@ static int parseOptions(int argc, char *argv[]){
   return 0;
 }
 
-static int initSemaphoreSharedMemory(){
-  if((semaphoreSharedMemoryKey = ftok("./oss", 1)) == -1) return -1;
-  //fprintf(stderr, "OSS: Semaphore Shared Memory Key: %d\n", semaphoreSharedMemoryKey);
-  if((semaphoreSharedMemoryId = shmget(semaphoreSharedMemoryKey, sizeof(sem_t), IPC_CREAT | 0644)) == -1){
-    perror("OSS: Failed to get shared memory for semaphore");
+/*
+ * Creates the one region shared with children and points every section at its place in it.
+ */
+static int initSharedRegion(){
+  unsigned int i;
+  if((region = createSharedRegion(regionName, numConcurrentProcesses, shardCount, messageQueueCapacity, hugePages)) == NULL){
+    if(errno == EEXIST) fprintf(stderr, "OSS: Shared region %s belongs to another oss that is still running. Give this run its own name with -N, or remove /dev/shm%s if that oss is gone.\n", regionName, regionName);
+    else perror("OSS: Failed to create shared region");
     return -1;
   }
-  //fprintf(stderr, "OSS: Semaphore Shared Memory ID: %d\n", semaphoreSharedMemoryId);
+  if((shards = calloc(shardCount, sizeof(shard_t))) == NULL) return -1;
+  for(i = 0; i < shardCount; i++){
+    shards[i].index = i;
+    shards[i].simClock = SHARED_REGION_SHARD(region, clock, i);
+    shards[i].lock = SHARED_REGION_SHARD(region, lock, i);
+    shards[i].message = SHARED_REGION_SHARD(region, message, i);
+    if(initEventQueue(&shards[i].deadlines, numConcurrentProcesses / shardCount + 1) == -1) return -1;
+  }
+  slots = SHARED_REGION_SECTION(region, slotsOffset);
+  stats = SHARED_REGION_SECTION(region, statsOffset);
+  sharedLog = SHARED_REGION_SECTION(region, logOffset);
   return 0;
 }
 
-static int initMessageSharedMemory(){
-  if((messageSharedMemoryKey = ftok("./oss", 2)) == -1) return -1;
-  //fprintf(stderr, "OSS: Message Shared Memory Key: %d\n", messageSharedMemoryKey);
-  if((messageSharedMemoryId = shmget(messageSharedMemoryKey, sizeof(shared_message_t), IPC_CREAT | 0644)) == -1){
-    perror("OSS: Failed to get shared memory for message");
+/*
+ * Before unmapping and removing the shared region, use this to destroy the lock.
+ */
+static int removeLock(sim_lock_t *lock){
+  if(simLockDestroy(lock) == -1){
+    perror("OSS: Failed to destroy lock");
     return -1;
   }
-  //fprintf(stderr, "OSS: Message Shared Memory ID: %d\n", messageSharedMemoryId);
   return 0;
 }
 
-static int initClockSharedMemory(){
-  if((clockSharedMemoryKey = ftok("./oss", 3)) == -1) return -1;
-  //fprintf(stderr, "OSS: Clock Shared Memory Key: %d\n", clockSharedMemoryKey);
-  if((clockSharedMemoryId = shmget(clockSharedMemoryKey, sizeof(sim_clock_t), IPC_CREAT | 0644)) == -1){
-    perror("OSS: Failed to get shared memory for clock");
+/*
+ * After the shared region has been created and mapped, use this to initialize the lock. 
+ */
+static int initLock(sim_lock_t *lock, int processOrThreadSharing){
+  if(simLockInit(lock, lockType, numConcurrentProcesses + 1, processOrThreadSharing) == -1){
+    perror("OSS: Failed to initialize lock");
     return -1;
   }
-  //fprintf(stderr, "OSS: Clock Shared Memory ID: %d\n", clockSharedMemoryId);
   return 0;
 }
 
-static int removeSemaphoreSharedMemory(){
-  if(shmctl(semaphoreSharedMemoryId, IPC_RMID, NULL) == -1){
-    perror("OSS: Failed to remove semaphore shared memory");
-    return -1;
+static void drainShardMessages(shard_t *shard);
+
+/*
+ * -D: handles what every shard queue holds, so terminations sent before shutdown are still logged.
+ */
+static void drainAllShards(){
+  unsigned int i;
+  pthread_mutex_lock(&bookkeeping);
+  for(i = 0; i < shardCount; i++) drainShardMessages(&shards[i]);
+  pthread_mutex_unlock(&bookkeeping);
+}
+
+#ifndef OSS_THREADED
+#define SHUTDOWN_REAP_BATCH 64
+
+/*
+ * One signal for every live child. Falls back to one kill per child if the group is gone.
+ */
+static void signalChildren(int signal){
+  int i;
+  if(childGroup > 0 && killpg(childGroup, signal) == 0) return;
+  for(i = 0; i < children.capacity; i++){
+    if(children.entries[i].pid > 0) kill(children.entries[i].pid, signal);
   }
-  return 0;
 }
 
-static int removeMessageSharedMemory(){
-  if(shmctl(messageSharedMemoryId, IPC_RMID, NULL) == -1){
-    perror("OSS: Failed to remove message shared memory");
+/*
+ * Ends every remaining child in bounded time: SIGTERM to the whole group, exits reaped in batches
+ * as the SIGCHLD signalfd reports them, and SIGKILL for whatever is left after termGrace ms. With
+ * -D each batch's messages are handled before its children leave the table.
+ */
+static void stopChildren(){
+  struct signalfd_siginfo notifications[16];
+  struct pollfd watcher = {childEventFd, POLLIN, 0};
+  siginfo_t info;
+  pid_t reaped[SHUTDOWN_REAP_BATCH];
+  unsigned int stopping = children.used, killed = 0, count, i;
+  unsigned long long start = monotonicNanoseconds(), now;
+  unsigned long long deadline = start + termGrace * 1000000ULL;
+  int slot, orphaned = 0;
+  if(stopping == 0) return;
+  signalChildren(SIGTERM);
+  while(children.used && !orphaned){
+    while(read(childEventFd, notifications, sizeof(notifications)) > 0);  //SIGCHLD coalesces, so just empty it
+    do{
+      for(count = 0; count < SHUTDOWN_REAP_BATCH; count++){
+        info.si_pid = 0;
+        if(waitid(P_ALL, 0, &info, WEXITED | WNOHANG) == -1){
+          orphaned = errno == ECHILD;  //the table lists children the kernel no longer has
+          break;
+        }
+        if(info.si_pid == 0) break;
+        reaped[count] = info.si_pid;
+      }
+      if(gracefulDrain && count) drainAllShards();
+      for(i = 0; i < count; i++){
+        if((slot = removeChild(&children, reaped[i])) != -1) releaseChildSlot(&children, slot);
+      }
+    }while(count == SHUTDOWN_REAP_BATCH);
+    if(children.used == 0 || orphaned) break;
+    if((now = monotonicNanoseconds()) >= deadline){
+      if(killed) break;
+      killed = children.used;
+      signalChildren(SIGKILL);
+      deadline = now + SHUTDOWN_KILL_WAIT * 1000000ULL;
+      continue;
+    }
+    poll(&watcher, 1, (deadline - now + 999999) / 1000000);
+  }
+  fprintf(stderr, "OSS: Stopped %u children in %.1f ms, %u with SIGKILL\n", stopping - children.used, (monotonicNanoseconds() - start) / 1e6, killed);
+  if(children.used) fprintf(stderr, "OSS: %u children did not exit\n", children.used);
+}
+#endif
+
+/*
+ * Runs on the main thread once every loop has stopped, never from a signal handler.
+ */
+static void cleanUp(int signal){
+  int i;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  double elapsed = (now.tv_sec - startTime.tv_sec) + (now.tv_nsec - startTime.tv_nsec) / 1e9;
+  maxChildProcesses = childCounter;  //nothing new starts or is handed a lifetime from here on
+  if(gracefulDrain) drainAllShards();
+#ifndef OSS_THREADED
+  stopChildren();
+  freeChildTable(&children);
+  free(lingeringSlots);
+  if(epollFd != -1) close(epollFd);
+  if(childEventFd != -1) close(childEventFd);
+  if(timerFd != -1) close(timerFd);
+  for(i = 0; i < shardCount; i++){
+    if(shards[i].message->notifyFd != -1) close(shards[i].message->notifyFd);
+    if(shardCount > 1 && shards[i].epollFd > 0) close(shards[i].epollFd);
+  }
+#else
+  //child threads still starting read their id from the table and post exits to the eventfd, so both are left for exit
+#endif
+  stopLogWriter(&logWriter);  //children are gone, so this drains everything they logged
+  if(logFile) fclose(logFile);  //NULL when the log file could not be opened
+  unsigned int overflows = 0;
+  unsigned int droppedRecords = droppedLogRecords(sharedLog);
+  for(i = 0; i < shardCount; i++){
+    freeEventQueue(&shards[i].deadlines);
+    overflows += shards[i].message->overflows;
+    if(shardCount > 1) fprintf(stderr, "OSS: Shard %d\n", i);
+    printSimLockStatistics(shards[i].lock, stderr);
+  }
+  stats->running = 0;
+  if(stats->lockRecoveries || stats->lockWaitersSkipped) fprintf(stderr, "OSS: Locks recovered from dead children :: %u, turns skipped for children that died waiting :: %u\n", stats->lockRecoveries, stats->lockWaitersSkipped);
+  if(stats->spawns) fprintf(stderr, "OSS: Mean spawn latency :: %.1f us, max :: %.1f us\n", stats->spawnNanoseconds / 1e3 / stats->spawns, stats->maxSpawnNanoseconds / 1e3);
+  if(stats->deliveries) fprintf(stderr, "OSS: Mean termination delivery latency :: %.1f us, max :: %.1f us\n", stats->deliveryNanoseconds / 1e3 / stats->deliveries, stats->maxDeliveryNanoseconds / 1e3);
+  if(stats->reaps) fprintf(stderr, "OSS: Mean termination-to-reap latency :: %.1f us, max :: %.1f us\n", stats->reapNanoseconds / 1e3 / stats->reaps, stats->maxReapNanoseconds / 1e3);
+  if(loopWallNanoseconds) fprintf(stderr, "OSS: Idle policy %s :: loop cpu %.3f s over %.3f s wall (%.0f%% of a core per shard), parks :: %llu\n", idlePolicyNames[idlePolicy], loopCpuNanoseconds / 1e9, loopWallNanoseconds / 1e9 / shardCount, 100.0 * loopCpuNanoseconds / loopWallNanoseconds, stats->parks);
+#ifdef OSS_THREADED
+  //child threads may still be running; the region is only unlinked and goes away with the process
+  for(i = 0; i < shardCount; i++){
+    if(lockType == LOCK_SYSVSEM && removeLock(shards[i].lock) == -1) fprintf(stderr, "OSS: Failed to remove lock");  //outlives the process otherwise
+  }
+#else
+  for(i = 0; i < shardCount; i++){
+    if(removeLock(shards[i].lock) == -1) fprintf(stderr, "OSS: Failed to remove lock");
+  }
+  if(closeSharedRegion(region) == -1) perror("OSS: Failed to unmap shared region");
+#endif
+  if(removeSharedRegion(regionName) == -1) perror("OSS: Failed to remove shared region");
+  fprintf(stderr, "OSS: Total children created :: %d\n", childCounter); 
+  fprintf(stderr, "OSS: Seed :: %llu\n", seed);
+  if(controlWindow) fprintf(stderr, "OSS: Concurrency limit :: %u after %u changes, best window %.1f lifetimes/s at %u\n", concurrencyLimit, control.decisions, control.bestThroughput, control.bestLimit);
+  for(i = 0; workload.classCount > 1 && i < workload.classCount; i++) fprintf(stderr, "OSS: Class %d `%s' :: %u children\n", i, workload.classes[i].spec, classChildren[i]);
+  fprintf(stderr, "OSS: Child lifecycles per second :: %.1f\n", completedLifetimes / elapsed);
+  fprintf(stderr, "OSS: Message queue overflows :: %u\n", overflows);
+  if(shardCount > 1) fprintf(stderr, "OSS: Shards :: %u, barriers passed :: %u\n", shardCount, barriersPassed);
+  fprintf(stderr, "OSS: Log records written :: %llu, dropped :: %u\n", logWriter.written, droppedRecords);
+}
+
+/*
+ * Only asks the loops to stop; main tears down once they have, where stdio, locks and free are safe.
+ */
+static void signalHandler(int signal){
+  stopSignal = signal;
+}
+
+static int initAlarmWatcher(){
+  struct sigaction action;
+  action.sa_handler = signalHandler;
+  action.sa_flags = 0;
+  return (sigemptyset(&action.sa_mask) || sigaction(SIGALRM, &action, NULL));
+}
+
+static int initInterruptWatcher(){
+  struct sigaction action;
+  action.sa_handler = signalHandler;
+  action.sa_flags = 0;
+  return (sigemptyset(&action.sa_mask) || sigaction(SIGINT, &action, NULL));
+}
+
+/*
+ * Draws the class and lifetime of the child about to start in slot, numbered by childCounter so
+ * pooled reuses count too, and leaves the class's hold and gap in the slot. Returns the lifetime.
+ */
+static sim_clock_t prepareChildWorkload(shared_child_slot_t *slot){
+  unsigned long long state = workloadStream(seed, childCounter);
+  unsigned int class = pickWorkloadClass(&workload, &state);
+  sim_clock_t aliveTime = sampleDistribution(&workload.classes[class].life, &state);
+  if(replayCount) aliveTime = replayAliveTimes[childCounter < replayCount ? childCounter : replayCount - 1];
+  slot->hold = workload.classes[class].hold;
+  slot->gap = workload.classes[class].gap;
+  slot->random = state;
+  classChildren[class]++;
+  return aliveTime;
+}
+
+#ifdef OSS_THREADED
+/*
+ * Child threads announce that they have returned through an eventfd registered with epoll, the
+ * threaded counterpart of the SIGCHLD signalfd.
+ */
+static int initChildWatcher(){
+  struct epoll_event event;
+  sigprocmask(SIG_SETMASK, NULL, &originalSignalMask);
+  if((exitedChildren = malloc(messageQueueSize(numConcurrentProcesses))) == NULL) return -1;
+  initMessageQueue(exitedChildren, numConcurrentProcesses);
+  if((childThreads = malloc(sizeof(pthread_t) * numConcurrentProcesses)) == NULL) return -1;
+  if((childEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) return -1;
+  if((epollFd = epoll_create1(EPOLL_CLOEXEC)) == -1) return -1;
+  event.events = EPOLLIN;
+  event.data.fd = childEventFd;
+  return epoll_ctl(epollFd, EPOLL_CTL_ADD, childEventFd, &event);
+}
+
+/*
+ * Runs the same simulation code as ./child. Signals are left to the main thread.
+ */
+static void *childThread(void *argument){
+  int slot = (int)(long)argument;
+  shard_t *shard = SHARD_OF(slot);
+  sigset_t mask;
+  child_context_t context;
+  shared_message_t exited;
+  uint64_t one = 1;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGALRM);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+  if((placement.ossCpu >= 0 || placement.cpuCount) && pinCurrentThread(childCpu(&placement, slot, numConcurrentProcesses)) == -1) perror("OSS: Failed to place child thread");
+  context.lock = shard->lock;
+  context.lockNode = slot;
+  context.simClock = shard->simClock;
+  context.message = shard->message;
+  context.slot = &slots[slot];
+  context.stats = &stats->children[slot];
+  context.log = sharedLog;
+  context.logRing = slot;
+  context.id = children.entries[slot].pid;  //fixed until this thread has been joined
+  runChild(&context);
+  setMessage(MESSAGE_EXIT, context.id, simClockNow(shard->simClock), &exited);
+  enqueueMessage(exitedChildren, &exited);  //never full: it holds one entry per slot
+  if(write(childEventFd, &one, sizeof(one)) == -1) perror("OSS: Failed to signal child thread exit");
+  return NULL;
+}
+
+static int spawnChild(){
+  int slot;
+  int error;
+  pid_t id;
+  if((slot = acquireChildSlot(&children)) == -1) return -1;
+  resetSharedChildSlot(&slots[slot], pooledMode);
+  slots[slot].aliveTime = prepareChildWorkload(&slots[slot]);
+  id = nextChildThreadId++;
+  addChild(&children, slot, id);
+  children.entries[slot].spawnedAt = monotonicNanoseconds();
+  if((error = pthread_create(&childThreads[slot], NULL, childThread, (void *)(long)slot))){
+    errno = error;
+    perror("OSS: Failed to create child thread");
+    removeChild(&children, id);
+    releaseChildSlot(&children, slot);
     return -1;
   }
-  return 0;
+  logEvent(sharedLog, numConcurrentProcesses, LOG_LEVEL_TRACE, LOG_MASTER_SPAWN, id, simClockNow(SHARD_OF(slot)->simClock), slots[slot].aliveTime);
+  childCounter++;
+  stats->childrenCreated = childCounter;
+  SHARD_OF(slot)->unpublishedChildren++;
+  return slot;
 }
 
-static int removeClockSharedMemory(){
-  if(shmctl(clockSharedMemoryId, IPC_RMID, NULL) == -1){
-    perror("OSS: Failed to remove clock shared memory");
+#else
+/*
+ * Blocks SIGCHLD and routes it through a signalfd registered with epoll, so terminated children
+ * are noticed as events and reaped without ever blocking on a particular pid.
+ */
+static int initChildWatcher(){
+  sigset_t mask;
+  struct epoll_event event;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  if(sigprocmask(SIG_BLOCK, &mask, &originalSignalMask) == -1) return -1;
+  if((childEventFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1) return -1;
+  if((epollFd = epoll_create1(EPOLL_CLOEXEC)) == -1) return -1;
+  event.events = EPOLLIN;
+  event.data.fd = childEventFd;
+  return epoll_ctl(epollFd, EPOLL_CTL_ADD, childEventFd, &event);
+}
+
+/*
+ * Starts ./child in a free slot with posix_spawn, restoring the signal mask oss had before it
+ * blocked SIGCHLD.
+ */
+static int spawnChild(){
+  pid_t childpid;
+  int slot;
+  int error;
+  char slotId[16], cpuId[16];
+  posix_spawnattr_t attributes;
+  if((slot = acquireChildSlot(&children)) == -1) return -1;
+  snprintf(slotId, sizeof(slotId), "%d", slot);
+  snprintf(cpuId, sizeof(cpuId), "%d", childCpu(&placement, slot, numConcurrentProcesses));
+  char *arguments[] = {"./child", "-r", regionName, "-i", slotId, NULL, NULL, NULL};
+  if(placement.ossCpu >= 0 || placement.cpuCount){  //children would otherwise inherit the oss cpu
+    arguments[5] = "-u";
+    arguments[6] = cpuId;
+  }
+  resetSharedChildSlot(&slots[slot], pooledMode);
+  slots[slot].aliveTime = prepareChildWorkload(&slots[slot]);
+  unsigned long long spawnedAt = monotonicNanoseconds();
+  //the group lives as long as any child in it, reaped or not; a child starting with none left opens a new one
+  if(children.used == 0) childGroup = 0;
+  posix_spawnattr_init(&attributes);
+  posix_spawnattr_setsigmask(&attributes, &originalSignalMask);
+  posix_spawnattr_setpgroup(&attributes, childGroup);
+  posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP);
+  error = posix_spawn(&childpid, "./child", NULL, &attributes, arguments, environ);
+  if(error == EPERM && childGroup){  //the group is gone after all
+    posix_spawnattr_setpgroup(&attributes, childGroup = 0);
+    error = posix_spawn(&childpid, "./child", NULL, &attributes, arguments, environ);
+  }
+  posix_spawnattr_destroy(&attributes);
+  if(error){
+    errno = error;
+    perror("OSS: Failed to spawn child");
+    releaseChildSlot(&children, slot);
     return -1;
   }
-  return 0;
+  if(childGroup == 0) childGroup = childpid;
+  addChild(&children, slot, childpid);
+  children.entries[slot].spawnedAt = spawnedAt;
+  logEvent(sharedLog, numConcurrentProcesses, LOG_LEVEL_TRACE, LOG_MASTER_SPAWN, childpid, simClockNow(SHARD_OF(slot)->simClock), slots[slot].aliveTime);
+  childCounter++;
+  stats->childrenCreated = childCounter;
+  SHARD_OF(slot)->unpublishedChildren++;
+  return slot;
 }
 
-static int detachSemaphoreSharedMemory(){
-  return shmdt(semaphore);
+#endif
+
+/*
+ * Returns retired slots to the free list once the lock has gone past the place in line their dead
+ * child left. A new child acquiring through the node earlier would unlink the waiters behind it.
+ * Called with the bookkeeping lock held.
+ */
+static void releaseLingeringSlots(){
+  unsigned int i = 0;
+  int slot;
+  while(i < lingeringCount){
+    slot = lingeringSlots[i];
+    if(simLockNodeInLine(SHARD_OF(slot)->lock, slot)) i++;
+    else{
+      releaseChildSlot(&children, slot);
+      lingeringSlots[i] = lingeringSlots[--lingeringCount];
+    }
+  }
 }
 
-static int detachClockSharedMemory(){
-  return shmdt(simClock);
+/*
+ * Frees a reaped child's slot, settles whatever it still owed the event bookkeeping and starts
+ * its replacement.
+ */
+static void retireChild(pid_t childpid){
+  int slot;
+  pthread_mutex_lock(&bookkeeping);
+  //with shard threads the reap can overtake the child's termination message
+  if((slot = findChildSlot(&children, childpid)) != -1) drainShardMessages(SHARD_OF(slot));
+  if((slot = removeChild(&children, childpid)) == -1){
+    pthread_mutex_unlock(&bookkeeping);
+    return;
+  }
+  logEvent(sharedLog, numConcurrentProcesses, LOG_LEVEL_TRACE, LOG_MASTER_REAP, childpid, simClockNow(SHARD_OF(slot)->simClock), 0);
+  //a child killed inside the critical section would otherwise leave every other child waiting on it
+  int recovered = simLockRecover(SHARD_OF(slot)->lock, slot);
+  if(recovered > 0){
+    if(recovered == LOCK_RECOVERED_HOLDER) stats->lockRecoveries++;
+    else stats->lockWaitersSkipped++;
+    logEvent(sharedLog, numConcurrentProcesses, LOG_LEVEL_TERMINATIONS, LOG_MASTER_RECOVERY, childpid, simClockNow(SHARD_OF(slot)->simClock), recovered);
+  }
+  switch(children.entries[slot].state){
+    case SLOT_STARTING: SHARD_OF(slot)->unpublishedChildren--; break;
+    case SLOT_DUE: SHARD_OF(slot)->dueChildren--; break;
+    case SLOT_REPORTED:
+      pendingReaps--;
+      SHARD_OF(slot)->reportedChildren--;
+      recordLatency(&stats->reaps, &stats->reapNanoseconds, &stats->maxReapNanoseconds, monotonicNanoseconds() - children.entries[slot].reportedAt);
+      break;
+  }
+  if(recovered == LOCK_RECOVERED_WAITER && simLockNodeInLine(SHARD_OF(slot)->lock, slot)){
+    children.entries[slot].pid = -1;
+    children.entries[slot].state = SLOT_FREE;
+    lingeringSlots[lingeringCount++] = slot;
+  }
+  else releaseChildSlot(&children, slot);
+  releaseLingeringSlots();
+  //a slot that lingered earlier may have come free too, so this can start more than one
+  while(childCounter < maxChildProcesses && children.used < concurrencyLimit && !stopSignal && spawnChild() != -1);
+  pthread_mutex_unlock(&bookkeeping);
 }
 
-static int detachMessageSharedMemory(){
-  return shmdt(message);
+#ifdef OSS_THREADED
+/*
+ * Joins every child thread that has announced its exit.
+ */
+static void reapChildren(){
+  uint64_t count;
+  shared_message_t exited;
+  int slot;
+  if(read(childEventFd, &count, sizeof(count)) == -1 && errno != EAGAIN) perror("OSS: Failed to read child thread exits");
+  while(dequeueMessage(exitedChildren, &exited)){
+    pthread_mutex_lock(&bookkeeping);
+    slot = findChildSlot(&children, exited.pid);
+    pthread_mutex_unlock(&bookkeeping);
+    if(slot == -1) continue;
+    pthread_join(childThreads[slot], NULL);
+    retireChild(exited.pid);
+  }
 }
 
-static int attachSemaphoreSharedMemory(){
-  if((semaphore = shmat(semaphoreSharedMemoryId, NULL, 0)) == (void *)-1) return -1;
-  return 0;
+#else
+/*
+ * Drains the SIGCHLD signalfd and reaps up to REAP_BATCH exited children with non-blocking waitid
+ * calls. Under -T children keep expiring while oss reaps, so the batch is bounded and a stop
+ * request ends it; the rest are left to the next call through reapBacklog.
+ */
+static void reapChildren(){
+  struct signalfd_siginfo notifications[16];
+  siginfo_t info;
+  unsigned int reaped;
+  while(read(childEventFd, notifications, sizeof(notifications)) > 0);  //SIGCHLD coalesces, so just empty it
+  for(reaped = 0; reaped < REAP_BATCH && !stopSignal; reaped++){
+    info.si_pid = 0;
+    if(waitid(P_ALL, 0, &info, WEXITED | WNOHANG) == -1){
+      if(errno != ECHILD) perror("OSS: Error waiting for child");
+      break;
+    }
+    if(info.si_pid == 0) break;
+    retireChild(info.si_pid);
+  }
+  reapBacklog = reaped == REAP_BATCH;
 }
 
-static int attachMessageSharedMemory(){
-  if((message = shmat(messageSharedMemoryId, NULL, 0)) == (void *)-1) return -1;
-  return 0;
+#endif
+
+/*
+ * Waits on an epoll set and handles what is ready: child exits are reaped, the run timer asks the
+ * loops to stop, and a message notification is only cleared since the caller drains its queue next.
+ * Only the main set holds the child signalfd, so only main's calls reap, backlog included; a shard
+ * thread's own set never does.
+ */
+static void pollEvents(int epoll, int timeout){
+  struct epoll_event events[4];
+  uint64_t count;
+  int i, ready, reaped = 0;
+  int reaper = epoll == epollFd;
+  if(reaper && reapBacklog) timeout = 0;  //exits already consumed from the signalfd are still waiting
+  ready = epoll_wait(epoll, events, 4, timeout);
+  for(i = 0; i < ready; i++){
+    if(events[i].data.fd == childEventFd){
+      reapChildren();
+      reaped = 1;
+    }
+    else if(events[i].data.fd == timerFd){
+      if(read(timerFd, &count, sizeof(count)) > 0) stopSignal = SIGALRM;
+    }
+    else if(read(events[i].data.fd, &count, sizeof(count)) == -1 && errno != EAGAIN) perror("OSS: Failed to read message notification");
+  }
+  if(reaper && reapBacklog && !reaped && !stopSignal) reapChildren();
 }
 
-static int attachClockSharedMemory(){
-  if((simClock = shmat(clockSharedMemoryId, NULL, 0)) == (void *)-1) return -1;
-  return 0;
+/*
+ * -I event: gives every shard queue an eventfd its producers write when oss waits, and puts it in
+ * the epoll set of whoever runs the shard. With one shard that is the main set, which also holds
+ * the child watcher and the run timer. The eventfds are not close-on-exec so children inherit them.
+ */
+static int initEventLoop(){
+  struct epoll_event event;
+  unsigned int i;
+  event.events = EPOLLIN;
+  for(i = 0; i < shardCount; i++){
+    if((shards[i].message->notifyFd = eventfd(0, EFD_NONBLOCK)) == -1) return -1;
+    if(shardCount == 1) shards[i].epollFd = epollFd;
+    else if((shards[i].epollFd = epoll_create1(EPOLL_CLOEXEC)) == -1) return -1;
+    event.data.fd = shards[i].message->notifyFd;
+    if(epoll_ctl(shards[i].epollFd, EPOLL_CTL_ADD, event.data.fd, &event) == -1) return -1;
+  }
+  if((timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) == -1) return -1;
+  event.data.fd = timerFd;
+  return epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &event);
 }
 
 /*
- * Before detaching and removing IPC shared memory, use this to destroy the semaphore.
+ * One -A control step, taken once per window from the loop that reaps. Spawns up to a raised
+ * limit at once; a lowered one takes effect as children retire without replacement.
  */
-static int removeSemaphore(sem_t *semaphore){
-  if(sem_destroy(semaphore) == -1){
-    perror("OSS: Failed to destroy semaphore");
-    return -1;
+static void adjustConcurrency(){
+  unsigned long long now = monotonicNanoseconds();
+  unsigned long long acquisitions = 0, waitNanoseconds = 0;
+  unsigned int i, node, limit = concurrencyLimit;
+  if(now - control.time < controlWindow * 1000000ULL) return;
+  for(i = 0; i < shardCount; i++){
+    for(node = 0; node < shards[i].lock->nodeCount; node++){
+      acquisitions += shards[i].lock->nodes[node].acquisitions;
+      waitNanoseconds += shards[i].lock->nodes[node].waitNanoseconds;
+    }
   }
-  return 0;
+  double throughput = (completedLifetimes - control.lifetimes) * 1e9 / (now - control.time);
+  double wait = acquisitions > control.acquisitions ? (double)(waitNanoseconds - control.waitNanoseconds) / (acquisitions - control.acquisitions) : 0;
+  int worse = throughput < control.throughput * (1 - CONTROL_TOLERANCE);
+  int better = throughput > control.throughput * (1 + CONTROL_TOLERANCE);
+  int contended = control.wait > 0 && wait > control.wait * CONTROL_WAIT_GROWTH;
+  int step = control.lastStep > 0 && (worse || (contended && !better)) ? -1 : 1;
+  control.time = now;
+  control.lifetimes = completedLifetimes;
+  control.acquisitions = acquisitions;
+  control.waitNanoseconds = waitNanoseconds;
+  if(control.settling){
+    control.settling = 0;  //measured partly under the old limit; the baseline stays the window before the change
+    return;
+  }
+  if(throughput > control.bestThroughput){
+    control.bestThroughput = throughput;
+    control.bestLimit = concurrencyLimit;  //the limit the window just measured ran under
+  }
+  if(step != control.pendingStep){
+    control.pendingStep = step;  //wait for the next window to agree before acting
+    return;
+  }
+  control.pendingStep = 0;
+  if(step < 0){
+    limit = limit * 3 / 4 > 0 ? limit * 3 / 4 : 1;  //multiplicative decrease
+    control.slowStart = 0;
+    control.lastStep = -1;
+  }
+  else{
+    limit = control.slowStart ? limit * 2 : limit + 1;  //additive increase
+    if(limit > numConcurrentProcesses) limit = numConcurrentProcesses;
+    control.lastStep = limit > concurrencyLimit ? 1 : 0;
+  }
+  control.throughput = throughput;
+  control.wait = wait;
+  if(limit == concurrencyLimit) return;
+  control.settling = 1;
+  pthread_mutex_lock(&bookkeeping);
+  concurrencyLimit = limit;
+  stats->concurrencyLimit = limit;
+  control.decisions++;
+  logEvent(sharedLog, numConcurrentProcesses, LOG_LEVEL_TERMINATIONS, LOG_MASTER_CONCURRENCY, limit, simClockNow(shards[0].simClock), (unsigned long long)throughput << 32 | (wait < 0xffffffffULL ? (unsigned long long)wait : 0xffffffffULL));
+  while(children.used < concurrencyLimit && childCounter < maxChildProcesses && spawnChild() != -1);
+  pthread_mutex_unlock(&bookkeeping);
 }
 
 /*
- * After IPC shared memory has been allocated and attached to process, use this to initialize the semaphore. 
+ * Discrete-event mode: once every live child of the shard has published its deadline and every
+ * due child has terminated and been reaped, jump the shard clock to the earliest pending deadline (or target, the
+ * next barrier or the end time, if that comes first). Called with the bookkeeping lock held.
  */
-static int initSemaphore(sem_t *semaphore, int processOrThreadSharing, unsigned int value){
-  if(sem_init(semaphore, processOrThreadSharing, value) == -1){
-    perror("OSS: Failed to initialize semaphore");
-    return -1;
+static void advanceToNextEvent(shard_t *shard, sim_clock_t target){
+  event_t *next;
+  event_t due;
+  int slot;
+  //a replacement starts when its predecessor is reaped, so the clock must not move before that
+  if(shard->unpublishedChildren || shard->dueChildren || shard->reportedChildren) return;
+  if((next = peekEvent(&shard->deadlines)) == NULL || next->time >= target) setSimClock(&shard->simClock->clock, target);
+  else setSimClock(&shard->simClock->clock, next->time);
+  shard->ticks++;
+  while((next = peekEvent(&shard->deadlines)) != NULL && shard->simClock->clock >= next->time){
+    popEvent(&shard->deadlines, &due);
+    if((slot = findChildSlot(&children, due.pid)) == -1 || children.entries[slot].state != SLOT_WAITING) continue;  //child already gone
+    children.entries[slot].state = SLOT_DUE;
+    shard->dueChildren++;
   }
-  return 0;
 }
 
-static void cleanUp(int signal){
-  int i;
-  for(i = 0; i < numConcurrentProcesses; i++){
-    if(children[i] > 0){
-      if(signal == 2) fprintf(stderr, "Parent sent SIGINT to Child %d\n", children[i]);
-      else if(signal == 14)fprintf(stderr, "Parent sent SIGALRM to Child %d\n", children[i]);
-      kill(children[i], signal);
-      waitpid(-1, NULL, 0);
+/*
+ * Called with the bookkeeping lock held.
+ */
+static void handleMessage(shard_t *shard, shared_message_t *received){
+  int slot;
+  if((slot = findChildSlot(&children, received->pid)) == -1) return;
+  child_entry_t *child = &children.entries[slot];
+  sim_clock_t now = simClockNow(shard->simClock);
+  if(received->type == MESSAGE_DEADLINE){  //child announced when it will terminate
+    if(child->state != SLOT_STARTING) return;
+    shard->unpublishedChildren--;
+    logEvent(sharedLog, numConcurrentProcesses, LOG_LEVEL_TRACE, LOG_MASTER_DEADLINE, received->pid, now, received->clock);
+    recordLatency(&stats->spawns, &stats->spawnNanoseconds, &stats->maxSpawnNanoseconds, monotonicNanoseconds() - child->spawnedAt);
+    if(now >= received->clock){
+      child->state = SLOT_DUE;
+      shard->dueChildren++;
+    }
+    else{
+      child->state = SLOT_WAITING;
+      if(discreteEventMode && pushEvent(&shard->deadlines, received->clock, received->pid) == -1) perror("OSS: Failed to queue deadline");
     }
+    return;
   }
-  free(children);
-  fclose(logFile);
-  if(detachMessageSharedMemory() == -1) perror("OSS: Failed to detach message memory");
-  if(removeMessageSharedMemory() == -1) perror("OSS: Failed to remove message memory");
-  if(detachClockSharedMemory() == -1) perror("OSS: Failed to detach clock memory");
-  if(removeClockSharedMemory() == -1) perror("OSS: Failed to remove clock memory");
-  if(removeSemaphore(semaphore) == -1) fprintf(stderr, "OSS: Failed to remove semaphore");
-  if(detachSemaphoreSharedMemory() == -1) perror("OSS: Failed to detach semaphore shared memory");
-  if(removeSemaphoreSharedMemory() == -1) perror("OSS: Failed to remove seamphore shared memory");
-  fprintf(stderr, "OSS: Total children created :: %d\n", childCounter); 
+  // child is terminating. 
+  if(child->state == SLOT_DUE) shard->dueChildren--;
+  else if(child->state == SLOT_STARTING) shard->unpublishedChildren--;
+  completedLifetimes++;
+  stats->lifetimesCompleted = completedLifetimes;
+  recordLatency(&stats->deliveries, &stats->deliveryNanoseconds, &stats->maxDeliveryNanoseconds, monotonicNanoseconds() - received->sentAt);
+  //queue the termination for the log writer; the last ring belongs to oss
+  logEvent(sharedLog, numConcurrentProcesses, LOG_LEVEL_TERMINATIONS, LOG_MASTER_TERMINATION, received->pid, now, received->clock);
+  //a pooled child is handed its next lifetime in place; otherwise it exits and is replaced once reaped
+  if(pooledMode && childCounter < maxChildProcesses && children.used <= concurrencyLimit){
+    child->state = SLOT_STARTING;
+    child->spawnedAt = monotonicNanoseconds();
+    sim_clock_t aliveTime = prepareChildWorkload(&slots[slot]);
+    logEvent(sharedLog, numConcurrentProcesses, LOG_LEVEL_TRACE, LOG_MASTER_SPAWN, received->pid, now, aliveTime);
+    childCounter++;
+    stats->childrenCreated = childCounter;
+    shard->unpublishedChildren++;
+    assignChildLifetime(&slots[slot], aliveTime);
+    return;
+  }
+  if(pooledMode) signalChildExit(&slots[slot]);
+  child->state = SLOT_REPORTED;
+  child->reportedAt = received->sentAt;
+  pendingReaps++;
+  shard->reportedChildren++;
 }
 
-static void signalHandler(int signal){
-  cleanUp(signal);
-  exit(signal);
+/*
+ * Called with the bookkeeping lock held, which also makes the holder the queue's only consumer.
+ */
+static void drainShardMessages(shard_t *shard){
+  shared_message_t received;
+  unsigned long long drained = 0, start = 0, took;
+  if(sharedLog->level >= LOG_LEVEL_TRACE) start = monotonicNanoseconds();
+  while(dequeueMessage(shard->message, &received)){
+    stats->messagesReceived++;
+    handleMessage(shard, &received);
+    drained++;
+  }
+  if(start){
+    took = monotonicNanoseconds() - start;
+    logEvent(sharedLog, numConcurrentProcesses, LOG_LEVEL_TRACE, LOG_MASTER_DRAIN, shard->index, simClockNow(shard->simClock), drained << 32 | (took < 0xffffffffULL ? took : 0xffffffffULL));
+  }
 }
 
-static int initAlarmWatcher(){
-  struct sigaction action;
-  action.sa_handler = signalHandler;
-  action.sa_flags = 0;
-  return (sigemptyset(&action.sa_mask) || sigaction(SIGALRM, &action, NULL));
+static void flushShardTicks(shard_t *shard){
+  if(shard->ticks) __atomic_add_fetch(&stats->clockTicks, shard->ticks, __ATOMIC_RELAXED);
+  shard->ticks = 0;
 }
 
-static int initInterruptWatcher(){
-  struct sigaction action;
-  action.sa_handler = signalHandler;
-  action.sa_flags = 0;
-  return (sigemptyset(&action.sa_mask) || sigaction(SIGINT, &action, NULL));
+/*
+ * Holds a shard at a simulated-time barrier until every shard has reached it. Waits time out so
+ * a stop request is never missed.
+ */
+static void waitShardBarrier(){
+  struct timespec timeout = {0, 10000000};
+  unsigned int generation = __atomic_load_n(&barrierGeneration, __ATOMIC_ACQUIRE);
+  if(__atomic_add_fetch(&barrierArrivals, 1, __ATOMIC_ACQ_REL) == shardCount){
+    barrierArrivals = 0;
+    barriersPassed++;
+    __atomic_add_fetch(&barrierGeneration, 1, __ATOMIC_RELEASE);
+    futexWake(&barrierGeneration, INT_MAX);
+    return;
+  }
+  while(__atomic_load_n(&barrierGeneration, __ATOMIC_ACQUIRE) == generation && !stopSignal) futexWait(&barrierGeneration, generation, &timeout);
+}
+
+/*
+ * A pass that neither moved the clock nor read a message. Only discrete-event mode has those: it
+ * waits on children to publish deadlines or terminate. Parking sleeps until a child posts to the
+ * queue, with a timeout that doubles each idle pass so owed reaps are still polled. The event
+ * policy needs no backoff: messages, child exits and the run timer all wake its epoll_wait.
+ */
+static void idleShard(shard_t *shard, unsigned int *idlePasses, long *backoff){
+  struct timespec timeout;
+  if(idlePolicy == IDLE_SPIN || ++*idlePasses < IDLE_SPIN_PASSES) return;
+  if(idlePolicy == IDLE_YIELD){
+    sched_yield();
+    return;
+  }
+  if(idlePolicy == IDLE_EVENT){
+    if(prepareMessageWait(shard->message)){
+      pollEvents(shard->epollFd, IDLE_EVENT_TIMEOUT);
+      __atomic_add_fetch(&stats->parks, 1, __ATOMIC_RELAXED);
+    }
+    finishMessageWait(shard->message);
+    return;
+  }
+  timeout.tv_sec = 0;
+  timeout.tv_nsec = *backoff;
+  parkMessageConsumer(shard->message, &timeout);
+  __atomic_add_fetch(&stats->parks, 1, __ATOMIC_RELAXED);
+  if((*backoff *= 2) > IDLE_MAX_BACKOFF) *backoff = IDLE_MAX_BACKOFF;
 }
 
 /*
- *  Transform an integer into a string
+ * Advances one shard's clock and drains its messages until endTime. With a single shard this runs
+ * on the main thread and also reaps; otherwise the main thread reaps and the shards meet at a
+ * barrier every barrierInterval of simulated time. A scaled clock advances on its own, so then a
+ * pass only drains messages and the shards need no barriers.
  */
-static char *itoa(int num){
-  char *asString = malloc(sizeof(char)*16);
-  snprintf(asString, sizeof(char)*16, "%d", num);
-  return asString;
+static void runShard(shard_t *shard, sim_clock_t endTime){
+  sim_clock_t barrier = shardCount > 1 && !timeScale ? barrierInterval : endTime;
+  sim_clock_t now, previous;
+  unsigned int passes = 0;
+  unsigned int idlePasses = 0;
+  long backoff = IDLE_MIN_BACKOFF;
+  int drained;
+  struct timespec cpuStart, cpuEnd;
+  unsigned long long wallStart = monotonicNanoseconds();
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStart);
+  while(!stopSignal){
+    sim_clock_t target = barrier < endTime ? barrier : endTime;
+    previous = shard->simClock->clock;
+    drained = 0;
+    if(discreteEventMode){
+      pthread_mutex_lock(&bookkeeping);
+      advanceToNextEvent(shard, target);
+      pthread_mutex_unlock(&bookkeeping);
+    }
+    else if(!timeScale){
+      if(incrementSimClock(&shard->simClock->clock, SIM_CLOCK_DEFAULT_INCREMENT) > target) setSimClock(&shard->simClock->clock, target);
+      shard->ticks++;
+    }
+    if(!timeScale) wakeSimClockWaiters(shard->simClock);
+    now = simClockNow(shard->simClock);
+    if(shard->index == 0) stats->simulatedNanoseconds = now;
+    if(now >= endTime) break;
+    //drain every message that is pending this pass
+    if(!messageQueueEmpty(shard->message)){
+      pthread_mutex_lock(&bookkeeping);
+      drainShardMessages(shard);
+      pthread_mutex_unlock(&bookkeeping);
+      drained = 1;
+    }
+    if((++passes & 1023) == 0) flushShardTicks(shard);
+    //check for exited children when a reap is owed, and periodically to catch children that died without a message
+    if(shardCount == 1 && (pendingReaps || reapBacklog || (passes & 1023) == 0)) pollEvents(epollFd, 0);
+    if(controlWindow && shardCount == 1 && (passes & 63) == 0) adjustConcurrency();
+    if(now >= barrier){
+      waitShardBarrier();
+      barrier += barrierInterval;
+    }
+    if((now != previous && !timeScale) || drained){
+      idlePasses = 0;
+      backoff = IDLE_MIN_BACKOFF;
+    }
+    else idleShard(shard, &idlePasses, &backoff);
+  }
+  flushShardTicks(shard);
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuEnd);
+  __atomic_add_fetch(&loopCpuNanoseconds, (cpuEnd.tv_sec - cpuStart.tv_sec) * 1000000000ULL + cpuEnd.tv_nsec - cpuStart.tv_nsec, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&loopWallNanoseconds, monotonicNanoseconds() - wallStart, __ATOMIC_RELAXED);
+}
+
+/*
+ * Shard thread: pinned to its own core, leaves signals and reaping to the main thread.
+ */
+static void *shardThread(void *argument){
+  shard_t *shard = argument;
+  sigset_t mask;
+  long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGALRM);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+  int firstCpu = placement.ossCpu >= 0 ? placement.ossCpu : 0;
+  if(pinCurrentThread((firstCpu + shard->index) % (cpuCount > 0 ? cpuCount : 1)) == -1) fprintf(stderr, "OSS: Failed to pin shard %u\n", shard->index);
+  runShard(shard, simulationEnd);
+  __atomic_add_fetch(&finishedShards, 1, __ATOMIC_RELEASE);
+  return NULL;
 }
 
 int main(int argc, char **argv){
   int status;
+  unsigned int i;
   parseOptions(argc, argv);
 
-  children = malloc(sizeof(pid_t) * numConcurrentProcesses);
-  logFile = fopen(logFilePath, "w");
+  if(initChildTable(&children, numConcurrentProcesses) == -1 || (lingeringSlots = malloc(sizeof(int) * numConcurrentProcesses)) == NULL) perror("OSS: Failed to allocate child table");
+  //threads oss starts from here on, and the children it spawns, inherit this placement
+  if(placement.ossCpu >= 0 && pinCurrentThread(placement.ossCpu) == -1) perror("OSS: Failed to pin oss");
+  if(placement.policy != POLICY_OTHER && applySchedulingPolicy(placement.policy, placement.priority) == -1) perror("OSS: Failed to set scheduling policy");
+  if(placement.niceSet && applyNice(placement.nice) == -1) perror("OSS: Failed to set nice level");
+  placement_t applied = placement;
+  readAppliedPlacement(&applied);  //the log header records what took effect, not what was asked for
+  char placementDescription[LOG_PLACEMENT_SIZE];
+  describePlacement(&applied, placementDescription, sizeof(placementDescription));
+  logFile = fopen(logFilePath, "wb");
 
 
   if(initAlarmWatcher() == -1) perror("OSS: Failed to init SIGALRM watcher");
   if(initInterruptWatcher() == -1) perror("OSS: Failed to init SIGINT watcher");
-  if(initSemaphoreSharedMemory() == -1) perror("OSS: Failed to init semaphore shared memory");
-  if(attachSemaphoreSharedMemory() == -1) perror("OSS: Failed to attach semaphore shared memory");
-  if(initSemaphore(semaphore, 1, 1) == -1) fprintf(stderr, "OSS: Failed to create semaphore");
-  if(initMessageSharedMemory() == -1) perror("OSS: Failed to init message memory");
-  if(attachMessageSharedMemory() == -1) perror("OSS: Failed to attach message memory");
-  if(initClockSharedMemory() == -1) perror("OSS: Failed to init clock memory");
-  if(attachClockSharedMemory() == -1) perror("OSS: Failed to attach clock memory");
+  if(initChildWatcher() == -1) perror("OSS: Failed to init SIGCHLD watcher");
+  if(initSharedRegion() == -1) exit(1);
+  for(i = 0; i < shardCount; i++){
+    if(initLock(shards[i].lock, LOCK_PSHARED) == -1) fprintf(stderr, "OSS: Failed to create lock");
+    initMessageQueue(shards[i].message, messageQueueCapacity);
+    resetSharedClock(shards[i].simClock);
+  }
+  initSimStats(stats, numConcurrentProcesses);
+  initSharedLog(sharedLog, numConcurrentProcesses + 1, logLevel);
+  if(logFile == NULL || startLogWriter(&logWriter, sharedLog, logFile, placementDescription, seed) == -1) perror("OSS: Failed to start log writer");
+  if(idlePolicy == IDLE_EVENT && initEventLoop() == -1){
+    perror("OSS: Failed to init event loop");
+    idlePolicy = IDLE_PARK;
+    for(i = 0; i < shardCount; i++) shards[i].message->notifyFd = -1;  //producers go back to the futex
+  }
  
 
 
-  resetMessage(message);
-  resetSimClock(simClock);
-  alarm(maxProcessTime);
-  pid_t childpid;
+  if(idlePolicy == IDLE_EVENT){
+    struct itimerspec limit = {{0, 0}, {maxProcessTime, 0}};
+    if(timerfd_settime(timerFd, 0, &limit, NULL) == -1) perror("OSS: Failed to arm run timer");
+  }
+  else alarm(maxProcessTime);
   
-  //loop forks off initial number of concurrent processes; each child exec's to its actually program
-  int i;
-  for(childCounter = 0; childCounter < numConcurrentProcesses; childCounter++){
-    if((childpid = fork()) > 0){  //parent code
-      children[childCounter] = childpid;
-    }
-    else if(childpid == 0){  //child code
-      execl("./child", "./child", "-s", itoa(semaphoreSharedMemoryId), "-m", itoa(messageSharedMemoryId), "-c", itoa(clockSharedMemoryId), NULL);
-    }
-    else{
-      perror("OSS: Failed to fork");
-    }
+  //spawns the initial number of concurrent processes; in pooled mode these are the only processes ever started
+  clock_gettime(CLOCK_MONOTONIC, &startTime);
+  stats->concurrencyLimit = concurrencyLimit;
+  if(timeScale){
+    unsigned long long origin = simClockMonotonic();
+    for(i = 0; i < shardCount; i++) startScaledSimClock(shards[i].simClock, timeScale, origin);
   }
+  control.time = monotonicNanoseconds();
+  control.slowStart = 1;
+  for(i = 0; i < concurrencyLimit && childCounter < maxChildProcesses && !stopSignal; i++) spawnChild();
 
 
-  //create endTime condition
-  sim_clock_t endTime;
-  endTime.seconds = 2;
-  endTime.nanoseconds = 0;
-
-  //loop to increment simulated clock and read messages from child processes; if a message is received, a child is terminating and should be replaced.
-  //this loop is valid until 2 seconds have passed in the simulated clock or maxChildProcesses have been created
-  while(1){
-    incrementSimClock(simClock);
-    if(compareSimClocks(simClock, &endTime)  != -1){
-      fprintf(stderr, "OSS: Out of Time\n"); 
-      break;
-    }
-    if(messageEmpty(message)){  
-      continue;
-    }
-    else{  // child is terminating. 
-      //wait for child and get pid
-      childpid = waitpid(-1, NULL, 0);
-      if(childpid == -1) perror("OSS: Error waiting for child");
-     
-      //resolve pid as index in children table
-      int id;
-      if((id = findId(childpid)) != -1){
-        children[id] = -1;
-        //output message to logfile
-        fprintf(stderr, "MASTER: Child %d is terminating at time %d.%10d because it reached %d.%10d in slave\n", childpid, simClock->seconds, simClock->nanoseconds, message->clock.seconds, message->clock.nanoseconds);
-        fprintf(logFile, "MASTER: Child %d is terminating at time %d.%10d because it reached %d.%10d in slave\n", childpid, simClock->seconds, simClock->nanoseconds, message->clock.seconds, message->clock.nanoseconds);
-        //fork another child
-        if(childCounter < maxChildProcesses){
-          if((childpid = fork()) > 0){ //parent code
-            children[id] = childpid;  //store new child's pid in children list
-            childCounter++;
-          }
-          else if(childpid == 0){  //child code
-            execl("./child", "./child", "-s", itoa(semaphoreSharedMemoryId), "-m", itoa(messageSharedMemoryId), "-c", itoa(clockSharedMemoryId), NULL);
-          }
-          else perror("OSS: Failed to fork");
-        }
-        resetMessage(message); //clear message
+  //loop to increment simulated clock and read messages from child processes; a child is replaced once it has been reaped.
+  //this loop is valid until 2 seconds have passed in the simulated clock
+  if(shardCount == 1) runShard(&shards[0], simulationEnd);
+  else{
+    unsigned int started;
+    for(started = 0; started < shardCount; started++){
+      if((status = pthread_create(&shards[started].thread, NULL, shardThread, &shards[started]))){
+        errno = status;
+        perror("OSS: Failed to start shard thread");
+        stopSignal = 2;  //the started shards would wait at the first barrier forever
+        break;
       }
     }
+    while(__atomic_load_n(&finishedShards, __ATOMIC_ACQUIRE) < shardCount && !stopSignal){
+      pollEvents(epollFd, 10);
+      if(controlWindow) adjustConcurrency();
+    }
+    for(i = 0; i < started; i++) pthread_join(shards[i].thread, NULL);
+  }
+  if(stopSignal){
+    cleanUp(stopSignal);
+    exit(stopSignal);
   }
+  fprintf(stderr, "OSS: Out of Time\n"); 
   cleanUp(2);
 
   return 0;
@@ -0,0 +1,268 @@
+/*
+ * ossbench: microbenchmarks for the pieces the oss loop and children lean on. Prints one
+ * "name value unit" line per benchmark; bench.sh adds the end-to-end runs and compares the lot
+ * against a baseline. Every figure is the best of several repetitions.
+ */
+
+#define _GNU_SOURCE
+#include "simulatedclock.h"
+#include "sharedmessage.h"
+#include "sharedstats.h"
+#include "simlock.h"
+#include "sharedlog.h"
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <sched.h>
+
+#define BENCH_REPETITIONS 5
+
+static double scale = 1.0;  //multiplies every iteration count
+static const char *only = NULL;  //run just the benchmarks whose name starts with this
+static volatile sim_clock_t sink;
+
+static void printOptions(){
+  fprintf(stderr, "OSSBENCH:  Command Help\n");
+  fprintf(stderr, "\tOSSBENCH:  '-h': Prints Command Usage\n");
+  fprintf(stderr, "\tOSSBENCH:  Optional '-x': Scale every iteration count by this factor. Default is 1.\n");
+  fprintf(stderr, "\tOSSBENCH:  Optional '-b': Only run benchmarks whose name starts with this prefix.\n");
+}
+
+static int parseOptions(int argc, char *argv[]){
+  int c;
+  while ((c = getopt (argc, argv, "hx:b:")) != -1){
+    switch (c){
+      case 'h':
+        printOptions();
+        exit(0);
+      case 'x':
+        scale = atof(optarg);
+        break;
+      case 'b':
+        only = optarg;
+        break;
+      case '?':
+	if(isprint (optopt))
+          fprintf(stderr, "OSSBENCH: Unknown option `-%c'.\n", optopt);
+        else
+          fprintf(stderr, "OSSBENCH: Unknown option character `\\x%x'.\n", optopt);
+        default:
+	  abort();
+    }
+  }
+  if(scale <= 0){
+    fprintf(stderr, "OSSBENCH: The scale must be positive.\n");
+    abort();
+  }
+  return 0;
+}
+
+static unsigned long iterations(unsigned long base){
+  unsigned long scaled = base * scale;
+  return scaled ? scaled : 1;
+}
+
+static int selected(const char *name){
+  return only == NULL || strncmp(name, only, strlen(only)) == 0;
+}
+
+/*
+ * Runs body BENCH_REPETITIONS times and reports the fastest run in nanoseconds per operation.
+ */
+static void report(const char *name, double (*body)(unsigned long), unsigned long count){
+  double best = 0, perOperation;
+  int i;
+  if(!selected(name)) return;
+  for(i = 0; i < BENCH_REPETITIONS; i++){
+    perOperation = body(count);
+    if(i == 0 || perOperation < best) best = perOperation;
+  }
+  printf("%s %.2f ns\n", name, best);
+  fflush(stdout);
+}
+
+static double clockRead(unsigned long count){
+  static shared_clock_t simClock;
+  unsigned long i;
+  sim_clock_t total = 0;
+  unsigned long long start = monotonicNanoseconds();
+  for(i = 0; i < count; i++) total += readSimClock(&simClock.clock);
+  sink = total;
+  return (double)(monotonicNanoseconds() - start) / count;
+}
+
+static double clockIncrement(unsigned long count){
+  static shared_clock_t simClock;
+  unsigned long i;
+  unsigned long long start = monotonicNanoseconds();
+  for(i = 0; i < count; i++) incrementSimClock(&simClock.clock, SIM_CLOCK_DEFAULT_INCREMENT);
+  sink = simClock.clock;
+  return (double)(monotonicNanoseconds() - start) / count;
+}
+
+static double clockCompare(unsigned long count){
+  unsigned long i;
+  sim_clock_t now = sink, total = 0;
+  unsigned long long start = monotonicNanoseconds();
+  for(i = 0; i < count; i++) total += compareSimClocks(addNanosecondsToSimClock(now, i), now + (i & 1023) * 997);
+  sink = total;
+  return (double)(monotonicNanoseconds() - start) / count;
+}
+
+/*
+ * The per-pass cost oss pays to wake children whose deadlines have passed, with none waiting.
+ */
+static double clockWake(unsigned long count){
+  static shared_clock_t simClock;
+  unsigned long i;
+  resetSharedClock(&simClock);
+  unsigned long long start = monotonicNanoseconds();
+  for(i = 0; i < count; i++){
+    incrementSimClock(&simClock.clock, SIM_CLOCK_DEFAULT_INCREMENT);
+    wakeSimClockWaiters(&simClock);
+  }
+  return (double)(monotonicNanoseconds() - start) / count;
+}
+
+static double messageSet(unsigned long count){
+  shared_message_t message;
+  unsigned long i;
+  unsigned long long start = monotonicNanoseconds();
+  for(i = 0; i < count; i++) setMessage(MESSAGE_TERMINATION, i, i, &message);
+  sink = message.clock;
+  return (double)(monotonicNanoseconds() - start) / count;
+}
+
+/*
+ * One enqueue and one dequeue, uncontended.
+ */
+static double messageRoundTrip(unsigned long count){
+  static shared_message_queue_t *queue;
+  shared_message_t message, received;
+  unsigned long i;
+  if(queue == NULL){
+    if((queue = malloc(messageQueueSize(64))) == NULL) return 0;
+    initMessageQueue(queue, 64);
+  }
+  setMessage(MESSAGE_TERMINATION, 1, 1, &message);
+  unsigned long long start = monotonicNanoseconds();
+  for(i = 0; i < count; i++){
+    enqueueMessage(queue, &message);
+    dequeueMessage(queue, &received);
+  }
+  sink = received.clock;
+  return (double)(monotonicNanoseconds() - start) / count;
+}
+
+/*
+ * One record into an enabled log ring, the cost of every traced lock event; the ring is drained as
+ * the oss writer would, so none are dropped.
+ */
+static double logRecord(unsigned long count){
+  static shared_log_t *log;
+  static log_record_t batch[LOG_RING_RECORDS];
+  unsigned long i;
+  if(log == NULL){
+    if((log = malloc(sharedLogSize(2))) == NULL) return 0;
+    initSharedLog(log, 2, LOG_LEVEL_TRACE);
+  }
+  unsigned long long start = monotonicNanoseconds();
+  for(i = 0; i < count; i++){
+    logEvent(log, 0, LOG_LEVEL_LOCK, LOG_CHILD_WAITING, 1, i, 0);
+    if((i & (LOG_RING_RECORDS - 1)) == LOG_RING_RECORDS - 1) drainLogRing(LOG_RING(log, 0), batch, LOG_RING_RECORDS);
+  }
+  return (double)(monotonicNanoseconds() - start) / count;
+}
+
+/*
+ * Two processes hand the lock back and forth. The holder keeps it until the other side has queued
+ * for it, so every release is a contended handoff that wakes or unblocks a waiter inside
+ * simLockAcquire, which is what a terminating child and oss do, and the releaser waits for the
+ * partner to take it before queueing again. Each side counts its arrivals at the lock and its
+ * acquisitions; the partner is queued while the first is ahead of the second.
+ */
+typedef struct{
+  volatile unsigned long arrivals;
+  volatile unsigned long acquisitions;
+}__attribute__((aligned(CACHE_LINE_SIZE))) ping_pong_side_t;
+
+static int pingPongLockType;
+
+static void pingPongSide(sim_lock_t *lock, ping_pong_side_t *sides, unsigned int me, unsigned long count){
+  ping_pong_side_t *partner = &sides[!me];
+  unsigned long i, taken;
+  for(i = 0; i < count; i++){
+    __atomic_store_n(&sides[me].arrivals, i + 1, __ATOMIC_SEQ_CST);
+    simLockAcquire(lock, me);
+    __atomic_store_n(&sides[me].acquisitions, i + 1, __ATOMIC_SEQ_CST);
+    //the partner cannot acquire while this side holds the lock, so once it has arrived it waits
+    while((taken = __atomic_load_n(&partner->acquisitions, __ATOMIC_SEQ_CST)) == __atomic_load_n(&partner->arrivals, __ATOMIC_SEQ_CST) && taken < count) sched_yield();
+    simLockRelease(lock, me);
+    //and it takes the lock before this side queues again, so the two strictly alternate
+    while(__atomic_load_n(&partner->acquisitions, __ATOMIC_SEQ_CST) == taken && taken < count) sched_yield();
+  }
+}
+
+static double lockPingPong(unsigned long count){
+  size_t size = sizeof(ping_pong_side_t) * 2 + simLockSize(2);
+  char *shared;
+  ping_pong_side_t *sides;
+  sim_lock_t *lock;
+  pid_t partner;
+  if((shared = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) return 0;
+  sides = (ping_pong_side_t *)shared;
+  lock = (sim_lock_t *)(shared + sizeof(ping_pong_side_t) * 2);
+  if(simLockInit(lock, pingPongLockType, 2, 1) == -1){
+    munmap(shared, size);
+    return 0;
+  }
+  unsigned long long start = monotonicNanoseconds();
+  if((partner = fork()) == 0){
+    pingPongSide(lock, sides, 1, count);
+    _exit(0);
+  }
+  pingPongSide(lock, sides, 0, count);
+  waitpid(partner, NULL, 0);
+  double perHandoff = (double)(monotonicNanoseconds() - start) / (count * 2);
+  simLockDestroy(lock);
+  munmap(shared, size);
+  return perHandoff;
+}
+
+/*
+ * posix_spawn and reap of a process that exits at once: the floor under every child lifecycle.
+ */
+static double spawnReap(unsigned long count){
+  char *arguments[] = {"true", NULL};
+  unsigned long i;
+  pid_t childpid;
+  unsigned long long start = monotonicNanoseconds();
+  for(i = 0; i < count; i++){
+    if(posix_spawn(&childpid, "/bin/true", NULL, NULL, arguments, environ) != 0) return 0;
+    waitpid(childpid, NULL, 0);
+  }
+  return (double)(monotonicNanoseconds() - start) / count;
+}
+
+int main(int argc, char **argv){
+  char name[64];
+  parseOptions(argc, argv);
+  report("clock_read", clockRead, iterations(50000000));
+  report("clock_increment", clockIncrement, iterations(50000000));
+  report("clock_add_compare", clockCompare, iterations(50000000));
+  report("clock_tick_wake", clockWake, iterations(5000000));
+  report("message_set", messageSet, iterations(5000000));
+  report("message_roundtrip", messageRoundTrip, iterations(10000000));
+  report("log_record", logRecord, iterations(10000000));
+  for(pingPongLockType = LOCK_SEM; pingPongLockType <= LOCK_ROBUST_MUTEX; pingPongLockType++){
+    snprintf(name, sizeof(name), "lock_pingpong_%s", simLockName(pingPongLockType));
+    report(name, lockPingPong, iterations(20000));
+  }
+  report("spawn_reap", spawnReap, iterations(500));
+  return 0;
+}
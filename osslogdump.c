@@ -0,0 +1,195 @@
+/*
+ * osslogdump: decodes the binary log oss writes and prints it in the original text format, or as
+ * a Chrome trace-event timeline.
+ */
+
+#include "sharedlog.h"
+#include "simlock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+
+static char defaultLogFilePath[] = "logfile.bin";
+static char *logFilePath = defaultLogFilePath;
+static int maxLevel = LOG_LEVEL_TRACE;
+static int printWallTime = 0;
+static int printPlacement = 0;
+static int printTimeline = 0;
+
+static void printOptions(){
+  fprintf(stderr, "OSSLOGDUMP:  Command Help\n");
+  fprintf(stderr, "\tOSSLOGDUMP:  '-h': Prints Command Usage\n");
+  fprintf(stderr, "\tOSSLOGDUMP:  Optional '-l': Filename of binary log file. Default is logfile.bin\n");
+  fprintf(stderr, "\tOSSLOGDUMP:  Optional '-v': Highest verbosity level to print. Default is 3, everything.\n");
+  fprintf(stderr, "\tOSSLOGDUMP:  Optional '-w': Prefix each line with wall-clock microseconds since the first record.\n");
+  fprintf(stderr, "\tOSSLOGDUMP:  Optional '-p': Print the seed, cpu placement and scheduling the run used before the records.\n");
+  fprintf(stderr, "\tOSSLOGDUMP:  Optional '-j': Print Chrome trace-event JSON for chrome://tracing or Perfetto instead. Needs a -v 3 log.\n");
+}
+
+static int parseOptions(int argc, char *argv[]){
+  int c;
+  while ((c = getopt (argc, argv, "hl:v:wpj")) != -1){
+    switch (c){
+      case 'h':
+        printOptions();
+        exit(0);
+      case 'l':
+        logFilePath = optarg;
+        break;
+      case 'v':
+        maxLevel = atoi(optarg);
+        break;
+      case 'w':
+        printWallTime = 1;
+        break;
+      case 'p':
+        printPlacement = 1;
+        break;
+      case 'j':
+        printTimeline = 1;
+        break;
+      case '?':
+	if(isprint (optopt))
+          fprintf(stderr, "OSSLOGDUMP: Unknown option `-%c'.\n", optopt);
+        else
+          fprintf(stderr, "OSSLOGDUMP: Unknown option character `\\x%x'.\n", optopt);
+        default:
+	  abort();
+    }
+  }
+  return 0;
+}
+
+static void printRecord(log_record_t *record){
+  switch(record->type){
+    case LOG_MASTER_TERMINATION:
+      printf("MASTER: Child %d is terminating at time %d.%10d because it reached %d.%10d in slave\n", record->pid, simClockSeconds(record->time), simClockNanoseconds(record->time), simClockSeconds(record->argument), simClockNanoseconds(record->argument));
+      break;
+    case LOG_CHILD_WAITING:
+      printf("CHILD %d: Waiting on semaphore\n", record->pid);
+      break;
+    case LOG_CHILD_ACQUIRED:
+      printf("CHILD %d: Acquired  semaphore\n", record->pid);
+      break;
+    case LOG_CHILD_PASSING:
+      printf("CHILD %d: Passing semaphore\n", record->pid);
+      break;
+    case LOG_CHILD_RELEASED:
+      printf("CHILD %d: Released semaphore\n", record->pid);
+      break;
+    case LOG_MASTER_SPAWN:
+      printf("MASTER: Child %d started at time %d.%10d to live %llu ns\n", record->pid, simClockSeconds(record->time), simClockNanoseconds(record->time), (unsigned long long)record->argument);
+      break;
+    case LOG_MASTER_DEADLINE:
+      printf("MASTER: Child %d will terminate at time %d.%10d\n", record->pid, simClockSeconds(record->argument), simClockNanoseconds(record->argument));
+      break;
+    case LOG_MASTER_CONCURRENCY:
+      printf("MASTER: Concurrency limit set to %d at time %d.%10d after %llu lifetimes/s and %llu ns mean lock wait\n", record->pid, simClockSeconds(record->time), simClockNanoseconds(record->time), (unsigned long long)(record->argument >> 32), (unsigned long long)(record->argument & 0xffffffffULL));
+      break;
+    case LOG_MASTER_REAP:
+      printf("MASTER: Child %d reaped at time %d.%10d\n", record->pid, simClockSeconds(record->time), simClockNanoseconds(record->time));
+      break;
+    case LOG_MASTER_RECOVERY:
+      if(record->argument == LOCK_RECOVERED_WAITER) printf("MASTER: Passed on the lock turn of Child %d, which died waiting, at time %d.%10d\n", record->pid, simClockSeconds(record->time), simClockNanoseconds(record->time));
+      else printf("MASTER: Recovered the lock from dead Child %d at time %d.%10d\n", record->pid, simClockSeconds(record->time), simClockNanoseconds(record->time));
+      break;
+    case LOG_MASTER_DRAIN:
+      printf("MASTER: Shard %d drained %llu messages in %llu ns at time %d.%10d\n", record->pid, (unsigned long long)(record->argument >> 32), (unsigned long long)(record->argument & 0xffffffffULL), simClockSeconds(record->time), simClockNanoseconds(record->time));
+      break;
+    default:
+      printf("UNKNOWN %u: record from %d\n", record->type, record->pid);
+  }
+}
+
+/*
+ * One trace event. Children are threads of process 1, named by pid; oss is process 0, with spawns,
+ * reaps and deadlines on thread 0 and each shard's message drains on its own thread. A child's
+ * lock wait runs from waiting to acquired and its hold from acquired to released.
+ */
+static void printTimelineEvent(log_record_t *record, unsigned long long firstWall, int *count){
+  const char *name, *phase;
+  int process = 0, thread = 0;
+  double timestamp = (long long)(record->wallNanoseconds - firstWall) / 1e3, duration = 0;
+  switch(record->type){
+    case LOG_CHILD_WAITING: name = "wait"; phase = "B"; process = 1; thread = record->pid; break;
+    case LOG_CHILD_ACQUIRED:
+      printf("%s\n{\"name\":\"wait\",\"ph\":\"E\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", (*count)++ ? "," : "", record->pid, timestamp);
+      name = "hold"; phase = "B"; process = 1; thread = record->pid; break;
+    case LOG_CHILD_RELEASED: name = "hold"; phase = "E"; process = 1; thread = record->pid; break;
+    case LOG_CHILD_PASSING: name = "termination"; phase = "i"; process = 1; thread = record->pid; break;
+    case LOG_MASTER_SPAWN: name = "spawn"; phase = "i"; break;
+    case LOG_MASTER_REAP: name = "reap"; phase = "i"; break;
+    case LOG_MASTER_DEADLINE: name = "deadline"; phase = "i"; break;
+    case LOG_MASTER_TERMINATION: name = "termination"; phase = "i"; break;
+    case LOG_MASTER_CONCURRENCY: name = "concurrency"; phase = "i"; break;
+    case LOG_MASTER_RECOVERY: name = "lock recovery"; phase = "i"; break;
+    case LOG_MASTER_DRAIN:
+      name = "drain"; phase = "X"; thread = record->pid + 1;
+      duration = (record->argument & 0xffffffffULL) / 1e3;
+      timestamp -= duration;
+      break;
+    default: return;
+  }
+  printf("%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f", (*count)++ ? "," : "", name, phase, process, thread, timestamp);
+  if(phase[0] == 'X') printf(",\"dur\":%.3f,\"args\":{\"messages\":%llu}", duration, (unsigned long long)(record->argument >> 32));
+  else if(phase[0] == 'i') printf(",\"s\":\"t\",\"args\":{\"pid\":%d,\"sim\":%llu}", record->pid, (unsigned long long)record->time);
+  printf("}");
+}
+
+/*
+ * Records from different rings reach the file out of order, so the earliest timestamp is found
+ * first and every event is placed relative to it.
+ */
+static void writeTimeline(FILE *file){
+  log_record_t record;
+  long start = ftell(file);
+  unsigned long long firstWall = ~0ULL;
+  int count = 1;  //events after the metadata need a separating comma
+  while(fread(&record, sizeof(record), 1, file) == 1) if(record.wallNanoseconds < firstWall) firstWall = record.wallNanoseconds;
+  fseek(file, start, SEEK_SET);
+  printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  printf("\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"oss\"}},");
+  printf("\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"children\"}}");
+  while(fread(&record, sizeof(record), 1, file) == 1) if(record.level <= maxLevel) printTimelineEvent(&record, firstWall, &count);
+  printf("\n]}\n");
+}
+
+int main(int argc, char **argv){
+  FILE *file;
+  log_file_header_t header;
+  log_record_t record;
+  unsigned long long firstWall = 0;
+  int first = 1;
+  parseOptions(argc, argv);
+  if((file = openLogFile(logFilePath, &header)) == NULL){
+    if(errno != EINVAL){
+      perror("OSSLOGDUMP: Failed to open log file");
+      exit(1);
+    }
+    fprintf(stderr, "OSSLOGDUMP: %s is not a log file from this version of oss.\n", logFilePath);
+    exit(2);
+  }
+  if(printTimeline){
+    writeTimeline(file);
+    fclose(file);
+    return 0;
+  }
+  if(printPlacement){
+    printf("SEED: %llu\n", header.seed);
+    printf("PLACEMENT: %s\n", header.placement);
+  }
+  while(fread(&record, sizeof(record), 1, file) == 1){
+    if(record.level > maxLevel) continue;
+    if(first){
+      firstWall = record.wallNanoseconds;
+      first = 0;
+    }
+    if(printWallTime) printf("%12.3f ", (long long)(record.wallNanoseconds - firstWall) / 1e3);
+    printRecord(&record);
+  }
+  fclose(file);
+  return 0;
+}
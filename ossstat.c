@@ -0,0 +1,138 @@
+/*
+ * ossstat: maps a running oss's shared region read-only and prints live statistics and lock
+ * rates once per interval, in the style of vmstat.
+ */
+
+#include "sharedstats.h"
+#include "simlock.h"
+#include "sharedregion.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <ctype.h>
+
+static unsigned int intervalMilliseconds = 1000;
+static int count = -1;  //number of reports; -1 runs until oss stops
+static char regionName[64];
+
+static void printOptions(){
+  fprintf(stderr, "OSSSTAT:  Command Help\n");
+  fprintf(stderr, "\tOSSSTAT:  '-h': Prints Command Usage\n");
+  fprintf(stderr, "\tOSSSTAT:  Optional '-i': Milliseconds between reports. Default is 1000.\n");
+  fprintf(stderr, "\tOSSSTAT:  Optional '-n': Number of reports before exiting. Default is until oss stops.\n");
+  fprintf(stderr, "\tOSSSTAT:  Optional '-N': Name of the region oss was started with. Default is /oss.<uid>.\n");
+}
+
+static int parseOptions(int argc, char *argv[]){
+  int c;
+  while ((c = getopt (argc, argv, "hi:n:N:")) != -1){
+    switch (c){
+      case 'h':
+        printOptions();
+        exit(0);
+      case 'i':
+        intervalMilliseconds = atoi(optarg);
+        break;
+      case 'n':
+        count = atoi(optarg);
+        break;
+      case 'N':
+        snprintf(regionName, sizeof(regionName), "%s", optarg);
+        break;
+      case '?':
+	if(isprint (optopt))
+          fprintf(stderr, "OSSSTAT: Unknown option `-%c'.\n", optopt);
+        else
+          fprintf(stderr, "OSSSTAT: Unknown option character `\\x%x'.\n", optopt);
+        default:
+	  abort();
+    }
+  }
+  if(!regionName[0]) defaultSharedRegionName(regionName, sizeof(regionName));
+  return 0;
+}
+
+typedef struct{
+  unsigned long long time;
+  unsigned long long ticks;
+  unsigned long long lifetimes;
+  unsigned long long messages;
+  unsigned long long acquisitions;
+  unsigned long long waitNanoseconds;
+  unsigned long long holdNanoseconds;
+  unsigned long long spins;
+  unsigned long long spawns;
+  unsigned long long spawnNanoseconds;
+  unsigned long long reaps;
+  unsigned long long reapNanoseconds;
+}sample_t;
+
+static void takeSample(shared_region_header_t *region, sim_stats_t *stats, sample_t *sample){
+  unsigned int i, shard;
+  sample->time = monotonicNanoseconds();
+  sample->ticks = stats->clockTicks;
+  sample->lifetimes = stats->lifetimesCompleted;
+  sample->messages = stats->messagesReceived;
+  sample->spawns = stats->spawns;
+  sample->spawnNanoseconds = stats->spawnNanoseconds;
+  sample->reaps = stats->reaps;
+  sample->reapNanoseconds = stats->reapNanoseconds;
+  sample->acquisitions = sample->waitNanoseconds = sample->spins = sample->holdNanoseconds = 0;
+  for(shard = 0; shard < region->shardCount; shard++){
+    sim_lock_t *lock = SHARED_REGION_SHARD(region, lock, shard);
+    for(i = 0; i < lock->nodeCount; i++){
+      sample->acquisitions += lock->nodes[i].acquisitions;
+      sample->waitNanoseconds += lock->nodes[i].waitNanoseconds;
+      sample->spins += lock->nodes[i].spins;
+    }
+  }
+  for(i = 0; i < stats->slotCount; i++) sample->holdNanoseconds += stats->children[i].holdNanoseconds;
+}
+
+static double perAverage(unsigned long long total, unsigned long long count){
+  return count ? (double)total / count : 0;
+}
+
+int main(int argc, char **argv){
+  shared_region_header_t *region;
+  sim_stats_t *stats;
+  sim_lock_t *lock;
+  sample_t previous, current;
+  int reports = 0;
+  parseOptions(argc, argv);
+  if((region = openSharedRegion(regionName, 1)) == NULL){
+    perror("OSSSTAT: Failed to attach to a running oss");
+    return 1;
+  }
+  stats = SHARED_REGION_SECTION(region, statsOffset);
+  lock = SHARED_REGION_SHARD(region, lock, 0);
+  takeSample(region, stats, &previous);
+  while(stats->running && (count < 0 || reports < count)){
+    usleep(intervalMilliseconds * 1000);
+    takeSample(region, stats, &current);
+    double seconds = (current.time - previous.time) / 1e9;
+    unsigned long long acquisitions = current.acquisitions - previous.acquisitions;
+    if(reports % 20 == 0){
+      printf("%10s %10s %9s %9s %9s %8s %8s %9s %9s %9s %5s %5s %6s\n", "sim-s", "ticks/s", "lives/s", "msgs/s", "acq/s", "wait-ns", "hold-ns", "spins/s", "spawn-us", "reap-us", "live", "recov", "lock");
+    }
+    printf("%10.6f %10.0f %9.0f %9.0f %9.0f %8.0f %8.0f %9.0f %9.1f %9.1f %5u %5u %6s\n",
+      stats->simulatedNanoseconds / 1e9,
+      (current.ticks - previous.ticks) / seconds,
+      (current.lifetimes - previous.lifetimes) / seconds,
+      (current.messages - previous.messages) / seconds,
+      acquisitions / seconds,
+      perAverage(current.waitNanoseconds - previous.waitNanoseconds, acquisitions),
+      perAverage(current.holdNanoseconds - previous.holdNanoseconds, acquisitions),
+      (current.spins - previous.spins) / seconds,
+      perAverage(current.spawnNanoseconds - previous.spawnNanoseconds, current.spawns - previous.spawns) / 1e3,
+      perAverage(current.reapNanoseconds - previous.reapNanoseconds, current.reaps - previous.reaps) / 1e3,
+      stats->concurrencyLimit,
+      stats->lockRecoveries,
+      simLockName(lock->type));
+    fflush(stdout);
+    previous = current;
+    reports++;
+  }
+  closeSharedRegion(region);
+  return 0;
+}
@@ -0,0 +1,170 @@
+#define _GNU_SOURCE  //CPU_SET, SCHED_BATCH, pthread_setaffinity_np
+#include "placement.h"
+#include <sched.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+void initPlacement(placement_t *placement){
+  memset(placement, 0, sizeof(*placement));
+  placement->ossCpu = -1;
+  placement->mode = PLACEMENT_ROUND_ROBIN;
+  placement->policy = POLICY_OTHER;
+}
+
+/*
+ * Accepts the taskset list form, e.g. "2-5,8".
+ */
+int parseCpuList(placement_t *placement, const char *list){
+  char *end;
+  placement->cpuCount = 0;
+  while(*list){
+    long first = strtol(list, &end, 10), last;
+    if(end == list || first < 0) return -1;
+    last = first;
+    if(*end == '-'){
+      list = end + 1;
+      last = strtol(list, &end, 10);
+      if(end == list || last < first) return -1;
+    }
+    for(; first <= last; first++){
+      if(first >= CPU_SETSIZE || placement->cpuCount == PLACEMENT_MAX_CPUS) return -1;
+      placement->cpus[placement->cpuCount++] = first;
+    }
+    if(*end == ',') end++;
+    else if(*end) return -1;
+    list = end;
+  }
+  return placement->cpuCount ? 0 : -1;
+}
+
+int parsePlacementMode(placement_t *placement, const char *name){
+  if(strcmp(name, "rr") == 0) placement->mode = PLACEMENT_ROUND_ROBIN;
+  else if(strcmp(name, "compact") == 0) placement->mode = PLACEMENT_COMPACT;
+  else return -1;
+  return 0;
+}
+
+/*
+ * "other", "batch", or "fifo" with an optional priority as "fifo:N" (default 1).
+ */
+int parseSchedulingPolicy(placement_t *placement, const char *name){
+  if(strcmp(name, "other") == 0) placement->policy = POLICY_OTHER;
+  else if(strcmp(name, "batch") == 0) placement->policy = POLICY_BATCH;
+  else if(strncmp(name, "fifo", 4) == 0 && (name[4] == '\0' || name[4] == ':')){
+    placement->policy = POLICY_FIFO;
+    placement->priority = name[4] ? atoi(name + 5) : 1;
+    if(placement->priority < sched_get_priority_min(SCHED_FIFO) || placement->priority > sched_get_priority_max(SCHED_FIFO)) return -1;
+  }
+  else return -1;
+  return 0;
+}
+
+int childCpu(const placement_t *placement, unsigned int slot, unsigned int slotCount){
+  unsigned int perCpu;
+  if(placement->cpuCount == 0) return -1;
+  if(placement->mode == PLACEMENT_ROUND_ROBIN) return placement->cpus[slot % placement->cpuCount];
+  perCpu = (slotCount + placement->cpuCount - 1) / placement->cpuCount;
+  return placement->cpus[slot / perCpu];
+}
+
+/*
+ * Pins the calling thread to cpu, or with -1 lets it run anywhere again; threads and spawned
+ * children otherwise inherit a pinned oss's single cpu.
+ */
+int pinCurrentThread(int cpu){
+  cpu_set_t cpus;
+  long i, cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+  int error;
+  CPU_ZERO(&cpus);
+  if(cpu >= 0) CPU_SET(cpu, &cpus);
+  else for(i = 0; i < cpuCount && i < CPU_SETSIZE; i++) CPU_SET(i, &cpus);
+  if((error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))){
+    errno = error;
+    return -1;
+  }
+  return 0;
+}
+
+int applySchedulingPolicy(int policy, int priority){
+  struct sched_param parameters;
+  int kernelPolicy = policy == POLICY_FIFO ? SCHED_FIFO : policy == POLICY_BATCH ? SCHED_BATCH : SCHED_OTHER;
+  int error;
+  parameters.sched_priority = policy == POLICY_FIFO ? priority : 0;
+  if((error = pthread_setschedparam(pthread_self(), kernelPolicy, &parameters))){
+    errno = error;
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Linux applies nice per thread, so this only touches the calling thread.
+ */
+int applyNice(int nice){
+  return setpriority(PRIO_PROCESS, syscall(SYS_gettid), nice);
+}
+
+/*
+ * Replaces what oss asked for with what the calling thread actually got, so a pin, policy or nice
+ * level the kernel refused is not recorded as applied. Child cpus are left as requested; each child
+ * pins itself and reports its own failure.
+ */
+void readAppliedPlacement(placement_t *placement){
+  cpu_set_t cpus;
+  struct sched_param parameters;
+  int kernelPolicy, nice, i;
+  if(pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0){
+    placement->ossCpu = -1;
+    if(CPU_COUNT(&cpus) == 1) for(i = 0; i < CPU_SETSIZE; i++) if(CPU_ISSET(i, &cpus)) placement->ossCpu = i;
+  }
+  if(pthread_getschedparam(pthread_self(), &kernelPolicy, &parameters) == 0){
+    placement->policy = kernelPolicy == SCHED_FIFO ? POLICY_FIFO : kernelPolicy == SCHED_BATCH ? POLICY_BATCH : POLICY_OTHER;
+    placement->priority = kernelPolicy == SCHED_FIFO ? parameters.sched_priority : 0;
+  }
+  errno = 0;
+  nice = getpriority(PRIO_PROCESS, syscall(SYS_gettid));
+  if(errno == 0){
+    placement->nice = nice;
+    placement->niceSet = placement->niceSet || nice != 0;
+  }
+}
+
+static const char *policyName(int policy){
+  switch(policy){
+    case POLICY_BATCH: return "batch";
+    case POLICY_FIFO: return "fifo";
+    default: return "other";
+  }
+}
+
+/*
+ * One line recorded in the log header, e.g. "oss cpu 0; children cpus 1-3 rr; policy fifo:1; nice 5".
+ */
+void describePlacement(const placement_t *placement, char *description, size_t size){
+  size_t used = 0;
+  unsigned int i;
+  if(placement->ossCpu >= 0) used += snprintf(description + used, size - used, "oss cpu %d; ", placement->ossCpu);
+  else used += snprintf(description + used, size - used, "oss unpinned; ");
+  if(placement->cpuCount){
+    used += snprintf(description + used, size - used, "children cpus ");
+    for(i = 0; i < placement->cpuCount && used < size; i++){
+      unsigned int last = i;
+      while(last + 1 < placement->cpuCount && placement->cpus[last + 1] == placement->cpus[last] + 1) last++;
+      if(last > i) used += snprintf(description + used, size - used, "%s%d-%d", i ? "," : "", placement->cpus[i], placement->cpus[last]);
+      else used += snprintf(description + used, size - used, "%s%d", i ? "," : "", placement->cpus[i]);
+      i = last;
+    }
+    if(used < size) used += snprintf(description + used, size - used, " %s; ", placement->mode == PLACEMENT_COMPACT ? "compact" : "rr");
+  }
+  else if(used < size) used += snprintf(description + used, size - used, "children unpinned; ");
+  if(used >= size) return;
+  if(placement->policy == POLICY_FIFO) used += snprintf(description + used, size - used, "policy fifo:%d", placement->priority);
+  else used += snprintf(description + used, size - used, "policy %s", policyName(placement->policy));
+  if(placement->niceSet && used < size) snprintf(description + used, size - used, "; nice %d", placement->nice);
+}
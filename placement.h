@@ -0,0 +1,49 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stddef.h>
+
+#define PLACEMENT_MAX_CPUS 1024
+#define PLACEMENT_ROUND_ROBIN 0  //slot i runs on cpus[i % cpuCount]
+#define PLACEMENT_COMPACT 1      //consecutive slots fill one cpu before moving to the next
+
+#define POLICY_OTHER 0  //SCHED_OTHER
+#define POLICY_BATCH 1  //SCHED_BATCH
+#define POLICY_FIFO 2   //SCHED_FIFO; needs CAP_SYS_NICE or an RLIMIT_RTPRIO allowance
+
+/*
+ * Where oss and the children run and how the kernel schedules them. Everything is optional; an
+ * unset field leaves the kernel's choice alone.
+ */
+typedef struct{
+  int ossCpu;                 //-1 when oss is not pinned
+  int cpus[PLACEMENT_MAX_CPUS];  //cpus children are spread over
+  unsigned int cpuCount;      //0 when children are not pinned
+  int mode;
+  int policy;                 //POLICY_OTHER, POLICY_BATCH or POLICY_FIFO
+  int priority;               //POLICY_FIFO priority
+  int nice;
+  int niceSet;
+}placement_t;
+
+void initPlacement(placement_t *placement);
+
+int parseCpuList(placement_t *placement, const char *list);
+
+int parsePlacementMode(placement_t *placement, const char *name);
+
+int parseSchedulingPolicy(placement_t *placement, const char *name);
+
+int childCpu(const placement_t *placement, unsigned int slot, unsigned int slotCount);
+
+int pinCurrentThread(int cpu);
+
+int applySchedulingPolicy(int policy, int priority);
+
+int applyNice(int nice);
+
+void readAppliedPlacement(placement_t *placement);
+
+void describePlacement(const placement_t *placement, char *description, size_t size);
+
+#endif
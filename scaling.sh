@@ -0,0 +1,15 @@
+#!/bin/sh
+# Measures child lifecycles per second for 1..4096 concurrent children.
+# Usage: ./scaling.sh [oss options...]   e.g. ./scaling.sh -e
+# Each run creates four lifetimes per concurrent slot (at least 1000) so start-up does not dominate.
+
+make oss child > /dev/null || exit 1
+printf "%-12s %-12s %s\n" "concurrent" "children" "lifecycles/s"
+n=1
+while [ $n -le 4096 ]; do
+  total=$((n * 4))
+  [ $total -lt 1000 ] && total=1000
+  rate=$(./oss -s $n -c $total -t 120 -l /dev/null "$@" 2>&1 | sed -n 's/^OSS: Child lifecycles per second :: //p')
+  printf "%-12s %-12s %s\n" $n $total "$rate"
+  n=$((n * 2))
+done
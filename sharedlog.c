@@ -0,0 +1,153 @@
+#include "sharedlog.h"
+#include "sharedstats.h"
+#include <string.h>
+#include <time.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <errno.h>
+
+#define WRITER_BATCH_RECORDS 4096
+#define WRITER_IDLE_NANOSECONDS 1000000  //sleep this long after a pass that found nothing
+
+
+static size_t ringBytes(unsigned int records){
+  size_t bytes = sizeof(log_ring_t) + sizeof(log_record_t) * records;
+  return (bytes + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+}
+
+/*
+ * The header takes one cache line, then ringCount - 1 child rings and the oss ring.
+ */
+size_t sharedLogSize(unsigned int ringCount){
+  return CACHE_LINE_SIZE + ringBytes(LOG_RING_RECORDS) * (ringCount - 1) + ringBytes(LOG_OSS_RING_RECORDS);
+}
+
+void initSharedLog(shared_log_t *log, unsigned int ringCount, int level){
+  unsigned int i;
+  memset(log, 0, sharedLogSize(ringCount));
+  log->level = level;
+  log->ringCount = ringCount;
+  log->ringBytes = ringBytes(LOG_RING_RECORDS);
+  for(i = 0; i < ringCount - 1; i++) LOG_RING(log, i)->mask = LOG_RING_RECORDS - 1;
+  LOG_RING(log, ringCount - 1)->mask = LOG_OSS_RING_RECORDS - 1;
+}
+
+/*
+ * Appends one record to ring if level is enabled. Never blocks and never formats.
+ */
+void logEvent(shared_log_t *log, unsigned int ring, int level, int type, pid_t pid, sim_clock_t time, sim_clock_t argument){
+  log_ring_t *target;
+  log_record_t *record;
+  unsigned int tail;
+  if(level > log->level) return;
+  target = LOG_RING(log, ring);
+  tail = target->tail;
+  if(tail - __atomic_load_n(&target->head, __ATOMIC_ACQUIRE) > target->mask){
+    target->dropped++;
+    return;
+  }
+  record = &target->records[tail & target->mask];
+  record->type = type;
+  record->level = level;
+  record->pid = pid;
+  record->wallNanoseconds = monotonicNanoseconds();
+  record->time = time;
+  record->argument = argument;
+  __atomic_store_n(&target->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+unsigned int drainLogRing(log_ring_t *ring, log_record_t *buffer, unsigned int space){
+  unsigned int head = ring->head;
+  unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  unsigned int count = 0;
+  while(head != tail && count < space){
+    buffer[count++] = ring->records[head & ring->mask];
+    head++;
+  }
+  __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+  return count;
+}
+
+unsigned int droppedLogRecords(shared_log_t *log){
+  unsigned int i, dropped = 0;
+  for(i = 0; i < log->ringCount; i++) dropped += LOG_RING(log, i)->dropped;
+  return dropped;
+}
+
+static unsigned int drainAllRings(log_writer_t *writer, log_record_t *batch){
+  unsigned int i, count = 0, total = 0;
+  for(i = 0; i < writer->log->ringCount; i++){
+    if(count == WRITER_BATCH_RECORDS){
+      fwrite(batch, sizeof(log_record_t), count, writer->file);
+      count = 0;
+    }
+    unsigned int drained = drainLogRing(LOG_RING(writer->log, i), batch + count, WRITER_BATCH_RECORDS - count);
+    count += drained;
+    total += drained;
+  }
+  if(count) fwrite(batch, sizeof(log_record_t), count, writer->file);
+  writer->written += total;
+  return total;
+}
+
+static void *runLogWriter(void *argument){
+  log_writer_t *writer = argument;
+  log_record_t *batch = malloc(sizeof(log_record_t) * WRITER_BATCH_RECORDS);
+  struct timespec idle = {0, WRITER_IDLE_NANOSECONDS};
+  if(batch == NULL) return NULL;
+  while(!__atomic_load_n(&writer->stopping, __ATOMIC_ACQUIRE)){
+    if(drainAllRings(writer, batch) == 0) nanosleep(&idle, NULL);
+  }
+  while(drainAllRings(writer, batch));  //final flush
+  free(batch);
+  return NULL;
+}
+
+int startLogWriter(log_writer_t *writer, shared_log_t *log, FILE *file, const char *placement, unsigned long long seed){
+  log_file_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, LOG_FILE_MAGIC, sizeof(LOG_FILE_MAGIC));
+  header.recordSize = sizeof(log_record_t);
+  header.level = log->level;
+  header.seed = seed;
+  snprintf(header.placement, sizeof(header.placement), "%s", placement);
+  if(fwrite(&header, sizeof(header), 1, file) != 1) return -1;
+  writer->log = log;
+  writer->file = file;
+  writer->stopping = 0;
+  writer->written = 0;
+  //the writer starts with every signal blocked, so handlers that tear oss down never run on it
+  sigset_t all, previous;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &previous);
+  int error = pthread_create(&writer->thread, NULL, runLogWriter, writer);
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+  if(error){
+    writer->file = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+void stopLogWriter(log_writer_t *writer){
+  if(writer->file == NULL) return;  //never started
+  __atomic_store_n(&writer->stopping, 1, __ATOMIC_RELEASE);
+  pthread_join(writer->thread, NULL);
+  fflush(writer->file);
+}
+
+/*
+ * Opens a log file and reads its header, leaving the file at the first record. Returns NULL with
+ * errno set to EINVAL if the file was not written by this version of oss.
+ */
+FILE *openLogFile(const char *path, log_file_header_t *header){
+  FILE *file;
+  if((file = fopen(path, "rb")) == NULL) return NULL;
+  if(fread(header, sizeof(*header), 1, file) != 1 || memcmp(header->magic, LOG_FILE_MAGIC, sizeof(LOG_FILE_MAGIC)) || header->recordSize != sizeof(log_record_t)){
+    fclose(file);
+    errno = EINVAL;
+    return NULL;
+  }
+  header->placement[LOG_PLACEMENT_SIZE - 1] = '\0';
+  return file;
+}
@@ -0,0 +1,100 @@
+#ifndef SHAREDLOG_H
+#define SHAREDLOG_H
+
+#include "simulatedclock.h"
+#include <sys/types.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_TERMINATIONS 1  //oss termination lines (the old logfile contents)
+#define LOG_LEVEL_LOCK 2          //child lock waits, acquisitions and releases
+#define LOG_LEVEL_TRACE 3         //every spawn, deadline, reap and lock release; oss -R replays the spawns
+
+#define LOG_MASTER_TERMINATION 1  //time: oss clock when read, argument: time the child reached
+#define LOG_CHILD_WAITING 2
+#define LOG_CHILD_ACQUIRED 3
+#define LOG_CHILD_PASSING 4
+#define LOG_MASTER_SPAWN 5        //time: oss clock, argument: simulated ns the child was given to live
+#define LOG_MASTER_DEADLINE 6     //time: oss clock when read, argument: time the child will terminate
+#define LOG_MASTER_REAP 7         //time: oss clock when reaped
+#define LOG_CHILD_RELEASED 8
+#define LOG_MASTER_CONCURRENCY 9  //pid: new live-child limit, argument: window lifetimes/s << 32 | mean lock wait ns
+#define LOG_MASTER_DRAIN 10       //pid: shard, argument: messages drained << 32 | wall ns the drain took
+#define LOG_MASTER_RECOVERY 11    //time: oss clock when the child was reaped, pid: that child, argument: LOCK_RECOVERED_HOLDER or _WAITER
+
+#define LOG_RING_RECORDS 128  //per child; must be a power of two
+#define LOG_OSS_RING_RECORDS 16384  //oss logs every termination, so its ring rides out a starved writer
+#define LOG_FILE_MAGIC "OSSLOG4"
+#define LOG_PLACEMENT_SIZE 240
+
+/*
+ * Fixed-size binary log record. Producers only copy values in; formatting happens in osslogdump.
+ */
+typedef struct{
+  unsigned short type;
+  unsigned short level;
+  pid_t pid;
+  unsigned long long wallNanoseconds;
+  sim_clock_t time;
+  sim_clock_t argument;
+}log_record_t;
+
+/*
+ * Single-producer/single-consumer ring: one per child slot plus a larger last one for oss. The
+ * writer thread in oss is the only consumer. Records are dropped (and counted) rather than
+ * blocking a full ring.
+ */
+typedef struct{
+  volatile unsigned int head __attribute__((aligned(CACHE_LINE_SIZE)));
+  volatile unsigned int tail __attribute__((aligned(CACHE_LINE_SIZE)));
+  volatile unsigned int dropped;
+  unsigned int mask;
+  log_record_t records[];
+}log_ring_t;
+
+typedef struct{
+  int level;
+  unsigned int ringCount;
+  size_t ringBytes;  //stride between child rings
+}shared_log_t;
+
+#define LOG_RING(log, index) ((log_ring_t *)((char *)(log) + CACHE_LINE_SIZE + (size_t)(index) * (log)->ringBytes))
+
+typedef struct{
+  char magic[8];
+  unsigned int recordSize;
+  unsigned int level;
+  unsigned long long seed;             //oss -r value that reproduces the run's lifetimes
+  char placement[LOG_PLACEMENT_SIZE];  //cpus and scheduling oss and the children ran with
+}log_file_header_t;
+
+/*
+ * Drains every ring into one buffer and writes it with a single fwrite per pass.
+ */
+typedef struct{
+  shared_log_t *log;
+  FILE *file;
+  volatile int stopping;
+  pthread_t thread;
+  unsigned long long written;
+}log_writer_t;
+
+size_t sharedLogSize(unsigned int ringCount);
+
+void initSharedLog(shared_log_t *log, unsigned int ringCount, int level);
+
+void logEvent(shared_log_t *log, unsigned int ring, int level, int type, pid_t pid, sim_clock_t time, sim_clock_t argument);
+
+unsigned int drainLogRing(log_ring_t *ring, log_record_t *buffer, unsigned int space);
+
+unsigned int droppedLogRecords(shared_log_t *log);
+
+int startLogWriter(log_writer_t *writer, shared_log_t *log, FILE *file, const char *placement, unsigned long long seed);
+
+void stopLogWriter(log_writer_t *writer);
+
+FILE *openLogFile(const char *path, log_file_header_t *header);
+
+#endif
@@ -1,18 +1,114 @@
 #include "simulatedclock.h"
 #include "sharedmessage.h"
+#include "sharedstats.h"
+#include "futex.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
 
 
-void resetMessage(shared_message_t *message){
-  message->clock.seconds = -1;
-  message->clock.nanoseconds = -1;
+static unsigned int roundUpPowerOfTwo(unsigned int value){
+  unsigned int result = 1;
+  while(result < value) result <<= 1;
+  return result;
 }
 
-int messageEmpty(shared_message_t *message){
-  if(message->clock.seconds == -1 && message->clock.nanoseconds == -1) return 1;
+size_t messageQueueSize(unsigned int capacity){
+  return sizeof(shared_message_queue_t) + sizeof(shared_message_entry_t) * roundUpPowerOfTwo(capacity);
+}
+
+void initMessageQueue(shared_message_queue_t *queue, unsigned int capacity){
+  unsigned int i;
+  queue->capacity = roundUpPowerOfTwo(capacity);
+  queue->mask = queue->capacity - 1;
+  queue->head = 0;
+  queue->tail = 0;
+  queue->overflows = 0;
+  queue->consumerParked = 0;
+  queue->wakeups = 0;
+  queue->notifyFd = -1;
+  for(i = 0; i < queue->capacity; i++) queue->entries[i].sequence = i;
+}
+
+/*
+ * Claims a slot by advancing tail, fills it, then publishes it by storing its sequence.
+ * Returns -1 and counts an overflow if the ring is full.
+ */
+int enqueueMessage(shared_message_queue_t *queue, shared_message_t *message){
+  shared_message_entry_t *entry;
+  unsigned int position = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+  while(1){
+    entry = &queue->entries[position & queue->mask];
+    int difference = (int)(__atomic_load_n(&entry->sequence, __ATOMIC_ACQUIRE) - position);
+    if(difference == 0){
+      if(__atomic_compare_exchange_n(&queue->tail, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+    else if(difference < 0){  //slot still holds an entry from the previous lap
+      __atomic_add_fetch(&queue->overflows, 1, __ATOMIC_RELAXED);
+      return -1;
+    }
+    else position = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+  }
+  entry->message = *message;
+  __atomic_store_n(&entry->sequence, position + 1, __ATOMIC_RELEASE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);  //pairs with the fence in parkMessageConsumer
+  if(__atomic_load_n(&queue->consumerParked, __ATOMIC_RELAXED)){
+    uint64_t one = 1;
+    __atomic_add_fetch(&queue->wakeups, 1, __ATOMIC_SEQ_CST);
+    if(queue->notifyFd == -1) futexWake(&queue->wakeups, 1);
+    else if(write(queue->notifyFd, &one, sizeof(one)) == -1 && errno != EAGAIN) perror("Failed to notify message consumer");  //EAGAIN: a wakeup is already pending
+  }
+  return 0;
+}
+
+/*
+ * Single consumer only. Returns 1 if a message was copied out, 0 if the ring is empty.
+ */
+int dequeueMessage(shared_message_queue_t *queue, shared_message_t *message){
+  unsigned int position = queue->head;
+  shared_message_entry_t *entry = &queue->entries[position & queue->mask];
+  if((int)(__atomic_load_n(&entry->sequence, __ATOMIC_ACQUIRE) - (position + 1)) < 0) return 0;
+  *message = entry->message;
+  __atomic_store_n(&entry->sequence, position + queue->capacity, __ATOMIC_RELEASE);
+  __atomic_store_n(&queue->head, position + 1, __ATOMIC_RELAXED);
+  return 1;
+}
+
+int messageQueueEmpty(shared_message_queue_t *queue){
+  shared_message_entry_t *entry = &queue->entries[queue->head & queue->mask];
+  if((int)(__atomic_load_n(&entry->sequence, __ATOMIC_ACQUIRE) - (queue->head + 1)) < 0) return 1;
   else return 0;
 }
 
-void setMessage(sim_clock_t *clock, shared_message_t *message){
-  message->clock.seconds = clock->seconds;
-  message->clock.nanoseconds = clock->nanoseconds;
+/*
+ * Announces that the consumer is about to sleep and returns 1 if the queue is still empty, in
+ * which case it may wait on notifyFd. consumerParked is raised before the last emptiness check
+ * and producers read it after publishing, so a post is never slept through. Always pair with
+ * finishMessageWait.
+ */
+int prepareMessageWait(shared_message_queue_t *queue){
+  __atomic_store_n(&queue->consumerParked, 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  return messageQueueEmpty(queue);
+}
+
+void finishMessageWait(shared_message_queue_t *queue){
+  __atomic_store_n(&queue->consumerParked, 0, __ATOMIC_RELAXED);
+}
+
+/*
+ * Sleeps on the wakeups futex until a producer posts or timeout passes.
+ */
+void parkMessageConsumer(shared_message_queue_t *queue, const struct timespec *timeout){
+  unsigned int wakeups = __atomic_load_n(&queue->wakeups, __ATOMIC_SEQ_CST);
+  if(prepareMessageWait(queue)) futexWait(&queue->wakeups, wakeups, timeout);
+  finishMessageWait(queue);
+}
+
+void setMessage(int type, pid_t pid, sim_clock_t clock, shared_message_t *message){
+  message->type = type;
+  message->pid = pid;
+  message->clock = clock;
+  message->sentAt = monotonicNanoseconds();
 }
@@ -2,15 +2,63 @@
 #define SHAREDMESSAGE_H
 
 #include "simulatedclock.h"
+#include <sys/types.h>
+#include <stddef.h>
+#include <time.h>
+
+#define MESSAGE_TERMINATION 0  //clock is the time the child terminated
+#define MESSAGE_DEADLINE 1     //clock is the time the child will terminate; used by discrete-event mode
+#define MESSAGE_EXIT 2         //threaded backend only: the child thread has returned and can be joined
 
 typedef struct{
+  int type;
+  pid_t pid;
   sim_clock_t clock;
+  unsigned long long sentAt;  //monotonic wall time the message was built, for delivery and reap latency
 }shared_message_t;
 
-void resetMessage(shared_message_t *message);
+/*
+ * Entries are padded to a cache line so children enqueueing at the same time do not false-share.
+ */
+typedef struct{
+  volatile unsigned int sequence;
+  shared_message_t message;
+}__attribute__((aligned(CACHE_LINE_SIZE))) shared_message_entry_t;
+
+/*
+ * Bounded multi-producer/single-consumer ring. Children enqueue without holding any lock;
+ * oss is the only consumer. capacity is always a power of two. A consumer with nothing to do
+ * can park on wakeups, or wait on notifyFd when it is an eventfd; producers only touch either
+ * when consumerParked is set.
+ */
+typedef struct{
+  unsigned int capacity;
+  unsigned int mask;
+  volatile unsigned int head;
+  volatile unsigned int tail;
+  volatile unsigned int overflows;
+  volatile unsigned int consumerParked __attribute__((aligned(CACHE_LINE_SIZE)));
+  volatile unsigned int wakeups;
+  int notifyFd;  //eventfd written instead of the futex, or -1; children inherit it at the same number
+  shared_message_entry_t entries[];
+}shared_message_queue_t;
+
+size_t messageQueueSize(unsigned int capacity);
+
+void initMessageQueue(shared_message_queue_t *queue, unsigned int capacity);
+
+int enqueueMessage(shared_message_queue_t *queue, shared_message_t *message);
+
+int dequeueMessage(shared_message_queue_t *queue, shared_message_t *message);
+
+int messageQueueEmpty(shared_message_queue_t *queue);
+
+int prepareMessageWait(shared_message_queue_t *queue);
+
+void finishMessageWait(shared_message_queue_t *queue);
 
-int messageEmpty(shared_message_t *message);
+void parkMessageConsumer(shared_message_queue_t *queue, const struct timespec *timeout);
 
-void setMessage(sim_clock_t *clock, shared_message_t *message);
+void setMessage(int type, pid_t pid, sim_clock_t clock, shared_message_t *message);
 
 #endif
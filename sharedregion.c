@@ -0,0 +1,133 @@
+#include "sharedregion.h"
+#include "sharedmessage.h"
+#include "childtable.h"
+#include "simlock.h"
+#include "sharedstats.h"
+#include "sharedlog.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+
+static size_t alignToCacheLine(size_t offset){
+  return (offset + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+}
+
+/*
+ * One region per user, so ossstat can find a running oss without being told its pid.
+ */
+void defaultSharedRegionName(char *name, size_t size){
+  snprintf(name, size, "/oss.%u", (unsigned int)getuid());
+}
+
+static void layoutSharedRegion(shared_region_header_t *header, unsigned int slotCount, unsigned int shardCount, unsigned int queueCapacity){
+  size_t offset = alignToCacheLine(sizeof(shared_region_header_t));
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, SHARED_REGION_MAGIC, sizeof(SHARED_REGION_MAGIC));
+  header->version = SHARED_REGION_VERSION;
+  header->slotCount = slotCount;
+  header->shardCount = shardCount;
+  header->clockOffset = offset;
+  header->clockStride = alignToCacheLine(sizeof(shared_clock_t));
+  offset += header->clockStride * shardCount;
+  header->lockOffset = offset;
+  header->lockStride = alignToCacheLine(simLockSize(slotCount + 1));
+  offset += header->lockStride * shardCount;
+  header->messageOffset = offset;
+  header->messageStride = alignToCacheLine(messageQueueSize(queueCapacity));
+  offset += header->messageStride * shardCount;
+  header->slotsOffset = offset;
+  offset = alignToCacheLine(offset + sizeof(shared_child_slot_t) * slotCount);
+  header->statsOffset = offset;
+  offset = alignToCacheLine(offset + simStatsSize(slotCount));
+  header->logOffset = offset;
+  offset = alignToCacheLine(offset + sharedLogSize(slotCount + 1));
+  header->size = offset;
+}
+
+/*
+ * Whether an existing region was left by an oss that no longer runs. One that cannot be read, such
+ * as one from another layout version or one still being created, counts as in use.
+ */
+static int abandonedSharedRegion(const char *name){
+  shared_region_header_t *region = openSharedRegion(name, 1);
+  int abandoned;
+  if(region == NULL) return errno == ENOENT;
+  abandoned = kill(region->creator, 0) == -1 && errno == ESRCH;
+  closeSharedRegion(region);
+  return abandoned;
+}
+
+/*
+ * Creates, sizes and maps the region and writes its header. A region of the same name is only
+ * replaced when the oss that created it is gone; otherwise this fails with EEXIST. Sections are left for their owners
+ * to initialize. With hugePages the mapping is advised onto transparent huge pages, which takes
+ * effect when the kernel's shmem_enabled setting allows it.
+ */
+shared_region_header_t *createSharedRegion(const char *name, unsigned int slotCount, unsigned int shardCount, unsigned int queueCapacity, int hugePages){
+  shared_region_header_t header;
+  shared_region_header_t *region;
+  int fd;
+  layoutSharedRegion(&header, slotCount, shardCount, queueCapacity);
+  header.creator = getpid();
+  while((fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644)) == -1){
+    if(errno != EEXIST) return NULL;
+    if(!abandonedSharedRegion(name)){
+      errno = EEXIST;
+      return NULL;
+    }
+    shm_unlink(name);  //a region left by an oss that was killed
+  }
+  if(ftruncate(fd, header.size) == -1){
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+  region = mmap(NULL, header.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(region == MAP_FAILED){
+    shm_unlink(name);
+    return NULL;
+  }
+#ifdef MADV_HUGEPAGE
+  if(hugePages && madvise(region, header.size, MADV_HUGEPAGE) == -1) perror("OSS: Failed to request huge pages");
+#endif
+  *region = header;
+  return region;
+}
+
+/*
+ * Maps an existing region, refusing one written by a different layout version.
+ */
+shared_region_header_t *openSharedRegion(const char *name, int readOnly){
+  shared_region_header_t *region;
+  struct stat status;
+  int fd;
+  if((fd = shm_open(name, readOnly ? O_RDONLY : O_RDWR, 0)) == -1) return NULL;
+  if(fstat(fd, &status) == -1 || status.st_size < sizeof(shared_region_header_t)){
+    close(fd);
+    errno = EINVAL;
+    return NULL;
+  }
+  region = mmap(NULL, status.st_size, readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(region == MAP_FAILED) return NULL;
+  if(memcmp(region->magic, SHARED_REGION_MAGIC, sizeof(SHARED_REGION_MAGIC)) || region->version != SHARED_REGION_VERSION || region->size != status.st_size){
+    munmap(region, status.st_size);
+    errno = EPROTO;
+    return NULL;
+  }
+  return region;
+}
+
+int closeSharedRegion(shared_region_header_t *region){
+  return munmap(region, region->size);
+}
+
+int removeSharedRegion(const char *name){
+  return shm_unlink(name);
+}
@@ -0,0 +1,48 @@
+#ifndef SHAREDREGION_H
+#define SHAREDREGION_H
+
+#include "simulatedclock.h"
+#include <stddef.h>
+#include <sys/types.h>
+
+#define SHARED_REGION_MAGIC "OSSSHM"
+#define SHARED_REGION_VERSION 9
+
+/*
+ * Header at the start of the one shm_open region oss shares with its children. Every section
+ * starts on its own cache line, so the clock oss writes every tick never shares a line with the
+ * lock or the message queue children write. The clock, lock and message queue are repeated once
+ * per shard; slot i belongs to shard i % shardCount.
+ */
+typedef struct{
+  char magic[8];
+  unsigned int version;
+  unsigned int slotCount;
+  unsigned int shardCount;
+  pid_t creator;         //the oss that owns the region; a later oss only replaces it once this is gone
+  size_t size;
+  size_t clockOffset;    //shared_clock_t, one per shard
+  size_t clockStride;
+  size_t lockOffset;     //sim_lock_t with slotCount + 1 nodes, one per shard
+  size_t lockStride;
+  size_t messageOffset;  //shared_message_queue_t, one per shard
+  size_t messageStride;
+  size_t slotsOffset;    //shared_child_slot_t[slotCount]
+  size_t statsOffset;    //sim_stats_t
+  size_t logOffset;      //shared_log_t with slotCount + 1 rings
+}shared_region_header_t;
+
+#define SHARED_REGION_SECTION(region, offset) ((void *)((char *)(region) + (region)->offset))
+#define SHARED_REGION_SHARD(region, section, shard) ((void *)((char *)(region) + (region)->section##Offset + (size_t)(shard) * (region)->section##Stride))
+
+void defaultSharedRegionName(char *name, size_t size);
+
+shared_region_header_t *createSharedRegion(const char *name, unsigned int slotCount, unsigned int shardCount, unsigned int queueCapacity, int hugePages);
+
+shared_region_header_t *openSharedRegion(const char *name, int readOnly);
+
+int closeSharedRegion(shared_region_header_t *region);
+
+int removeSharedRegion(const char *name);
+
+#endif
@@ -0,0 +1,29 @@
+#include "sharedstats.h"
+#include <string.h>
+#include <time.h>
+
+
+size_t simStatsSize(unsigned int slotCount){
+  return sizeof(sim_stats_t) + sizeof(sim_child_stats_t) * slotCount;
+}
+
+void initSimStats(sim_stats_t *stats, unsigned int slotCount){
+  memset(stats, 0, simStatsSize(slotCount));
+  stats->slotCount = slotCount;
+  stats->running = 1;
+}
+
+/*
+ * Only ever called by one writer per set of counters, so plain read-modify-write is enough.
+ */
+void recordLatency(volatile unsigned long long *count, volatile unsigned long long *total, volatile unsigned long long *max, unsigned long long nanoseconds){
+  *count += 1;
+  *total += nanoseconds;
+  if(nanoseconds > *max) *max = nanoseconds;
+}
+
+unsigned long long monotonicNanoseconds(){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
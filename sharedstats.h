@@ -0,0 +1,53 @@
+#ifndef SHAREDSTATS_H
+#define SHAREDSTATS_H
+
+#include "simulatedclock.h"
+#include <stddef.h>
+
+/*
+ * Counters a child updates about itself. One cache line per slot so children never share a line.
+ * Lock acquisitions, wait time and spin counts live in the lock's own nodes (simlock.h).
+ */
+typedef struct{
+  volatile unsigned long long holdNanoseconds;
+  volatile unsigned long long messagesSent;
+  volatile unsigned long long queueRetries;  //enqueues retried because the message queue was full
+}__attribute__((aligned(CACHE_LINE_SIZE))) sim_child_stats_t;
+
+/*
+ * Live statistics segment. The global counters are written only by oss; ossstat attaches the
+ * segment read-only and turns them into rates.
+ */
+typedef struct{
+  unsigned int slotCount;
+  volatile int running;
+  volatile unsigned long long simulatedNanoseconds;
+  volatile unsigned long long clockTicks;
+  volatile unsigned long long childrenCreated;
+  volatile unsigned long long lifetimesCompleted;
+  volatile unsigned long long messagesReceived;
+  volatile unsigned long long spawns;
+  volatile unsigned long long spawnNanoseconds;     //spawn call until the child published its deadline
+  volatile unsigned long long maxSpawnNanoseconds;
+  volatile unsigned long long reaps;
+  volatile unsigned long long reapNanoseconds;      //termination message sent until the child was reaped
+  volatile unsigned long long maxReapNanoseconds;
+  volatile unsigned long long deliveries;
+  volatile unsigned long long deliveryNanoseconds;  //termination message sent until oss read it
+  volatile unsigned long long maxDeliveryNanoseconds;
+  volatile unsigned long long parks;                //times an idle oss loop slept on its message queue
+  volatile unsigned int concurrencyLimit;           //live children oss currently allows; moves with -A
+  volatile unsigned int lockRecoveries;             //locks oss released for children that died holding them
+  volatile unsigned int lockWaitersSkipped;         //ticket or MCS turns oss passed on for children that died in line
+  sim_child_stats_t children[] __attribute__((aligned(CACHE_LINE_SIZE)));
+}sim_stats_t;
+
+size_t simStatsSize(unsigned int slotCount);
+
+void initSimStats(sim_stats_t *stats, unsigned int slotCount);
+
+void recordLatency(volatile unsigned long long *count, volatile unsigned long long *total, volatile unsigned long long *max, unsigned long long nanoseconds);
+
+unsigned long long monotonicNanoseconds();
+
+#endif
@@ -0,0 +1,334 @@
+#include "simlock.h"
+#include "futex.h"
+#include "sharedstats.h"
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+
+#define SPIN_LIMIT 100  //busy-wait this many checks before sleeping on a futex
+
+union semun{
+  int val;
+  struct semid_ds *buf;
+  unsigned short *array;
+};
+
+static const char *lockNames[] = {"sem", "sysvsem", "futex", "ticket", "mcs", "robust-mutex"};
+
+/*
+ * Spins briefly while *address == value, then sleeps on it. Returns once it differs.
+ */
+static void waitWhileEqual(volatile unsigned int *address, unsigned int value, unsigned long long *spinCount){
+  int spins;
+  for(spins = 0; spins < SPIN_LIMIT; spins++, (*spinCount)++){
+    if(__atomic_load_n(address, __ATOMIC_ACQUIRE) != value) return;
+  }
+  while(__atomic_load_n(address, __ATOMIC_ACQUIRE) == value) futexWait(address, value, NULL);
+}
+
+size_t simLockSize(unsigned int nodeCount){
+  return sizeof(sim_lock_t) + sizeof(sim_lock_node_t) * nodeCount;
+}
+
+int simLockType(const char *name){
+  int i;
+  for(i = 0; i < sizeof(lockNames) / sizeof(lockNames[0]); i++){
+    if(strcmp(name, lockNames[i]) == 0) return i;
+  }
+  return -1;
+}
+
+const char *simLockName(int type){
+  if(type < 0 || type >= sizeof(lockNames) / sizeof(lockNames[0])) return "unknown";
+  return lockNames[type];
+}
+
+int simLockInit(sim_lock_t *lock, int type, unsigned int nodeCount, int processShared){
+  pthread_mutexattr_t attributes;
+  union semun argument;
+  memset(lock, 0, simLockSize(nodeCount));
+  lock->type = type;
+  lock->nodeCount = nodeCount;
+  switch(type){
+    case LOCK_SEM:
+      return sem_init(&lock->semaphore, processShared, 1);
+    case LOCK_SYSVSEM:
+      if((lock->sysvSemaphoreId = semget(IPC_PRIVATE, 1, IPC_CREAT | 0600)) == -1) return -1;
+      argument.val = 1;
+      return semctl(lock->sysvSemaphoreId, 0, SETVAL, argument);
+    case LOCK_FUTEX:
+    case LOCK_TICKET:
+    case LOCK_MCS:
+      return 0;  //zeroed memory is the unlocked state
+    case LOCK_ROBUST_MUTEX:
+      pthread_mutexattr_init(&attributes);
+      pthread_mutexattr_setpshared(&attributes, processShared ? PTHREAD_PROCESS_SHARED : PTHREAD_PROCESS_PRIVATE);
+      pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+      errno = pthread_mutex_init(&lock->mutex, &attributes);
+      pthread_mutexattr_destroy(&attributes);
+      return errno ? -1 : 0;
+  }
+  errno = EINVAL;
+  return -1;
+}
+
+int simLockDestroy(sim_lock_t *lock){
+  switch(lock->type){
+    case LOCK_SEM:
+      return sem_destroy(&lock->semaphore);
+    case LOCK_SYSVSEM:
+      return semctl(lock->sysvSemaphoreId, 0, IPC_RMID);
+    case LOCK_ROBUST_MUTEX:
+      errno = pthread_mutex_destroy(&lock->mutex);
+      return errno ? -1 : 0;
+  }
+  return 0;
+}
+
+static int acquireFutex(sim_lock_t *lock, unsigned int node){
+  unsigned int state = 0;
+  int spins;
+  for(spins = 0; spins < SPIN_LIMIT; spins++, lock->nodes[node].spins++){
+    state = 0;
+    if(__atomic_compare_exchange_n(&lock->futex, &state, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return 0;
+  }
+  //0 = free, 1 = held, 2 = held with sleepers
+  if(state != 2) state = __atomic_exchange_n(&lock->futex, 2, __ATOMIC_ACQUIRE);
+  while(state != 0){
+    futexWait(&lock->futex, 2, NULL);
+    state = __atomic_exchange_n(&lock->futex, 2, __ATOMIC_ACQUIRE);
+  }
+  return 0;
+}
+
+static int releaseFutex(sim_lock_t *lock){
+  if(__atomic_fetch_sub(&lock->futex, 1, __ATOMIC_RELEASE) != 1){
+    __atomic_store_n(&lock->futex, 0, __ATOMIC_RELEASE);
+    futexWake(&lock->futex, 1);
+  }
+  return 0;
+}
+
+static int acquireTicket(sim_lock_t *lock, unsigned int node){
+  unsigned int ticket = __atomic_fetch_add(&lock->ticket.next, 1, __ATOMIC_RELAXED);
+  unsigned int serving;
+  int spins = 0;
+  __atomic_store_n(&lock->nodes[node].ticket, ticket + 1, __ATOMIC_RELAXED);
+  while((serving = __atomic_load_n(&lock->ticket.serving, __ATOMIC_ACQUIRE)) != ticket){
+    if(++spins > SPIN_LIMIT) futexWait(&lock->ticket.serving, serving, NULL);
+    else lock->nodes[node].spins++;
+  }
+  return 0;  //the ticket stamp stays until the owner is stamped
+}
+
+/*
+ * Passes over every ticket now being served whose waiter died in line. Both the releaser and oss
+ * call this after their own update, so whichever comes second sees the other's; the compare and
+ * swap on serving lets only one of them skip each ticket.
+ */
+static void skipAbandonedTickets(sim_lock_t *lock){
+  unsigned int serving, i, ticket;
+  while(__atomic_load_n(&lock->ticket.abandoned, __ATOMIC_SEQ_CST)){
+    serving = __atomic_load_n(&lock->ticket.serving, __ATOMIC_SEQ_CST);
+    for(i = 0; i < lock->nodeCount && __atomic_load_n(&lock->nodes[i].abandonedTicket, __ATOMIC_SEQ_CST) != serving + 1; i++);
+    if(i == lock->nodeCount) return;  //whoever holds serving is alive
+    if(!__atomic_compare_exchange_n(&lock->ticket.serving, &serving, serving + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) continue;
+    ticket = serving + 1;
+    if(__atomic_compare_exchange_n(&lock->nodes[i].abandonedTicket, &ticket, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) __atomic_sub_fetch(&lock->ticket.abandoned, 1, __ATOMIC_SEQ_CST);
+    futexWake(&lock->ticket.serving, INT_MAX);
+  }
+}
+
+static int releaseTicket(sim_lock_t *lock){
+  __atomic_add_fetch(&lock->ticket.serving, 1, __ATOMIC_SEQ_CST);
+  futexWake(&lock->ticket.serving, INT_MAX);  //all waiters share the word; only the next ticket proceeds
+  skipAbandonedTickets(lock);
+  return 0;
+}
+
+static int acquireMcs(sim_lock_t *lock, unsigned int node){
+  sim_lock_node_t *self = &lock->nodes[node];
+  unsigned int previous;
+  self->next = 0;
+  self->locked = 1;
+  self->abandoned = 0;
+  __atomic_store_n(&self->queued, 1, __ATOMIC_SEQ_CST);
+  previous = __atomic_exchange_n(&lock->mcsTail, node + 1, __ATOMIC_ACQ_REL);
+  if(previous == 0) return 0;
+  __atomic_store_n(&lock->nodes[previous - 1].next, node + 1, __ATOMIC_RELEASE);
+  waitWhileEqual(&self->locked, 1, &self->spins);
+  return 0;
+}
+
+/*
+ * Takes over a waiter oss marked dead, so exactly one of oss and the releaser that handed it the
+ * lock passes the lock on for it.
+ */
+static int claimAbandonedMcsNode(sim_lock_t *lock, unsigned int node){
+  unsigned int expected = 1;
+  return __atomic_compare_exchange_n(&lock->nodes[node].abandoned, &expected, 2, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Hands the lock to the next waiter, and on past any waiter that died in line. passingOver is set
+ * when node itself is such a waiter, claimed by the caller; its mark is cleared once the lock has
+ * left it, which is what tells oss the node can be handed to a new child.
+ */
+static int releaseMcs(sim_lock_t *lock, unsigned int node, int passingOver){
+  unsigned int successor;
+  while(1){
+    successor = __atomic_load_n(&lock->nodes[node].next, __ATOMIC_ACQUIRE);
+    if(successor == 0){
+      unsigned int expected = node + 1;
+      if(__atomic_compare_exchange_n(&lock->mcsTail, &expected, 0, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)){
+        if(passingOver) __atomic_store_n(&lock->nodes[node].abandoned, 0, __ATOMIC_SEQ_CST);
+        return 0;
+      }
+      while((successor = __atomic_load_n(&lock->nodes[node].next, __ATOMIC_ACQUIRE)) == 0) sched_yield();  //successor is linking in
+    }
+    __atomic_store_n(&lock->nodes[successor - 1].locked, 0, __ATOMIC_SEQ_CST);
+    futexWake(&lock->nodes[successor - 1].locked, 1);
+    if(passingOver) __atomic_store_n(&lock->nodes[node].abandoned, 0, __ATOMIC_SEQ_CST);  //node is not read again
+    if(__atomic_load_n(&lock->nodes[successor - 1].abandoned, __ATOMIC_SEQ_CST) != 1 || !claimAbandonedMcsNode(lock, successor - 1)) return 0;
+    node = successor - 1;
+    passingOver = 1;
+  }
+}
+
+static int acquireRobustMutex(sim_lock_t *lock){
+  int error = pthread_mutex_lock(&lock->mutex);
+  if(error == EOWNERDEAD) error = pthread_mutex_consistent(&lock->mutex);  //previous holder died holding it
+  if(error){
+    errno = error;
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Acquires the lock on behalf of node and records how long the caller waited.
+ */
+int simLockAcquire(sim_lock_t *lock, unsigned int node){
+  struct sembuf operation = {0, -1, SEM_UNDO};
+  unsigned long long start = monotonicNanoseconds();
+  unsigned long long waited;
+  int result = -1;
+  switch(lock->type){
+    case LOCK_SEM: 
+      while((result = sem_wait(&lock->semaphore)) == -1 && errno == EINTR);
+      break;
+    case LOCK_SYSVSEM:
+      while((result = semop(lock->sysvSemaphoreId, &operation, 1)) == -1 && errno == EINTR);
+      break;
+    case LOCK_FUTEX: result = acquireFutex(lock, node); break;
+    case LOCK_TICKET: result = acquireTicket(lock, node); break;
+    case LOCK_MCS: result = acquireMcs(lock, node); break;
+    case LOCK_ROBUST_MUTEX: result = acquireRobustMutex(lock); break;
+  }
+  if(result == -1) return -1;
+  __atomic_store_n(&lock->owner, node + 1, __ATOMIC_RELAXED);
+  //the waiter stamps oss would otherwise recover from are only dropped once owner covers the node
+  if(lock->type == LOCK_TICKET) __atomic_store_n(&lock->nodes[node].ticket, 0, __ATOMIC_RELAXED);
+  else if(lock->type == LOCK_MCS) __atomic_store_n(&lock->nodes[node].queued, 0, __ATOMIC_RELAXED);
+  waited = monotonicNanoseconds() - start;
+  lock->nodes[node].acquisitions++;
+  lock->nodes[node].waitNanoseconds += waited;
+  if(waited > lock->nodes[node].maxWaitNanoseconds) lock->nodes[node].maxWaitNanoseconds = waited;
+  return 0;
+}
+
+int simLockRelease(sim_lock_t *lock, unsigned int node){
+  struct sembuf operation = {0, 1, SEM_UNDO};
+  __atomic_store_n(&lock->owner, 0, __ATOMIC_RELAXED);
+  switch(lock->type){
+    case LOCK_SEM: return sem_post(&lock->semaphore);
+    case LOCK_SYSVSEM: return semop(lock->sysvSemaphoreId, &operation, 1);
+    case LOCK_FUTEX: return releaseFutex(lock);
+    case LOCK_TICKET: return releaseTicket(lock);
+    case LOCK_MCS: return releaseMcs(lock, node, 0);
+    case LOCK_ROBUST_MUTEX:
+      if((errno = pthread_mutex_unlock(&lock->mutex))) return -1;
+      return 0;
+  }
+  errno = EINVAL;
+  return -1;
+}
+
+/*
+ * Called by oss once node's user is known to be dead. If it died holding the lock, releases it on
+ * its behalf and returns LOCK_RECOVERED_HOLDER. If it died waiting in a ticket or MCS line, its turn
+ * is passed on when it comes and LOCK_RECOVERED_WAITER is returned. Returns 0 if it had neither.
+ * The System V semaphore was already restored by the kernel through SEM_UNDO, and a robust mutex
+ * cannot be unlocked by anyone but its owner: the kernel hands the next locker EOWNERDEAD and
+ * acquireRobustMutex makes it consistent.
+ */
+int simLockRecover(sim_lock_t *lock, unsigned int node){
+  sim_lock_node_t *self = &lock->nodes[node];
+  unsigned int owner = node + 1, ticket;
+  if(__atomic_compare_exchange_n(&lock->owner, &owner, 0, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)){
+    __atomic_store_n(&self->ticket, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&self->queued, 0, __ATOMIC_RELAXED);
+    switch(lock->type){
+      case LOCK_SEM:
+        if(sem_post(&lock->semaphore) == -1) return -1;
+        break;
+      case LOCK_FUTEX: releaseFutex(lock); break;
+      case LOCK_TICKET: releaseTicket(lock); break;
+      case LOCK_MCS: releaseMcs(lock, node, 0); break;
+    }
+    return LOCK_RECOVERED_HOLDER;
+  }
+  if(lock->type == LOCK_TICKET && (ticket = __atomic_exchange_n(&self->ticket, 0, __ATOMIC_SEQ_CST)) != 0){
+    __atomic_store_n(&self->abandonedTicket, ticket, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&lock->ticket.abandoned, 1, __ATOMIC_SEQ_CST);
+    skipAbandonedTickets(lock);
+    return LOCK_RECOVERED_WAITER;
+  }
+  if(lock->type == LOCK_MCS && __atomic_exchange_n(&self->queued, 0, __ATOMIC_SEQ_CST)){
+    //if the lock already reached it, the releaser may have moved on before seeing the mark
+    __atomic_store_n(&self->abandoned, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&self->locked, __ATOMIC_SEQ_CST) == 0 && claimAbandonedMcsNode(lock, node)) releaseMcs(lock, node, 1);
+    return LOCK_RECOVERED_WAITER;
+  }
+  return 0;
+}
+
+/*
+ * Whether a node simLockRecover passed over still stands in line. Until the lock has gone past it
+ * the node must not be given to a new user: acquiring through it would reset the links and marks
+ * the waiters behind it depend on.
+ */
+int simLockNodeInLine(sim_lock_t *lock, unsigned int node){
+  if(lock->type == LOCK_TICKET) return __atomic_load_n(&lock->nodes[node].abandonedTicket, __ATOMIC_SEQ_CST) != 0;
+  if(lock->type == LOCK_MCS) return __atomic_load_n(&lock->nodes[node].abandoned, __ATOMIC_SEQ_CST) != 0;
+  return 0;
+}
+
+/*
+ * Acquisition latency and fairness across nodes. Fairness is Jain's index over per-node
+ * acquisition counts of the nodes that acquired at least once (1.0 means perfectly even).
+ */
+void printSimLockStatistics(sim_lock_t *lock, FILE *stream){
+  unsigned long long acquisitions = 0, waitNanoseconds = 0, maxWait = 0, fewest = 0, most = 0;
+  double sumSquares = 0;
+  unsigned int users = 0;
+  unsigned int i;
+  for(i = 0; i < lock->nodeCount; i++){
+    sim_lock_node_t *node = &lock->nodes[i];
+    if(node->acquisitions == 0) continue;
+    if(users == 0 || node->acquisitions < fewest) fewest = node->acquisitions;
+    if(node->acquisitions > most) most = node->acquisitions;
+    users++;
+    acquisitions += node->acquisitions;
+    waitNanoseconds += node->waitNanoseconds;
+    sumSquares += (double)node->acquisitions * node->acquisitions;
+    if(node->maxWaitNanoseconds > maxWait) maxWait = node->maxWaitNanoseconds;
+  }
+  fprintf(stream, "OSS: Lock '%s' acquisitions :: %llu\n", simLockName(lock->type), acquisitions);
+  if(acquisitions == 0) return;
+  fprintf(stream, "OSS: Lock mean wait :: %.0f ns, max wait :: %llu ns\n", (double)waitNanoseconds / acquisitions, maxWait);
+  fprintf(stream, "OSS: Lock per-slot share :: min %.2f%%, max %.2f%% over %u slots, Jain fairness :: %.3f\n",
+    100.0 * fewest / acquisitions, 100.0 * most / acquisitions, users, (double)acquisitions * acquisitions / (users * sumSquares));
+}
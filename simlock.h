@@ -0,0 +1,87 @@
+#ifndef SIMLOCK_H
+#define SIMLOCK_H
+
+#include "simulatedclock.h"
+#include <semaphore.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define LOCK_SEM 0           //POSIX unnamed semaphore
+#define LOCK_SYSVSEM 1       //System V semaphore set with SEM_UNDO
+#define LOCK_FUTEX 2         //three-state futex mutex
+#define LOCK_TICKET 3        //FIFO ticket lock, waiters sleep on the serving counter
+#define LOCK_MCS 4           //MCS queue lock, each waiter sleeps on its own node
+#define LOCK_ROBUST_MUTEX 5  //process-shared robust pthread mutex
+
+/*
+ * One node per lock user (child slot, plus one for oss). Holds the MCS queue links and the
+ * acquisition statistics for whoever uses that node, padded so users never share a line.
+ */
+typedef struct{
+  volatile unsigned int next;     //MCS successor node index + 1, 0 for none
+  volatile unsigned int locked;   //MCS: 1 while this node must keep waiting
+  volatile unsigned int ticket;   //ticket lock: ticket + 1 while waiting
+  volatile unsigned int abandonedTicket;  //ticket lock: ticket + 1 of a waiter that died in line, until skipped
+  volatile unsigned int queued;   //MCS: 1 from joining the queue until the owner is stamped
+  volatile unsigned int abandoned;  //MCS: 1 once oss marked this waiter dead, 2 while someone passes the lock on for it, then 0
+  unsigned long long acquisitions;
+  unsigned long long waitNanoseconds;
+  unsigned long long maxWaitNanoseconds;
+  unsigned long long spins;       //busy-wait iterations before acquiring or sleeping
+}__attribute__((aligned(CACHE_LINE_SIZE))) sim_lock_node_t;
+
+/*
+ * owner stamps which node holds the lock, so oss can release it for a child that died inside the
+ * critical section (simLockRecover). It is set just after acquiring and cleared just before
+ * releasing, so two short windows are not covered: a death after the lock is taken but before
+ * owner is stamped, and one after owner is cleared but before the release. Either leaves the lock
+ * held by no one under sem and futex. The ticket and MCS locks keep their waiter stamp until owner
+ * is set, which closes the first window for them, and oss passes their turn on for waiters that
+ * died in line. That leaves, for those two, a death between taking a ticket and stamping it, or
+ * between joining the MCS queue and linking behind the predecessor. sysvsem and robust-mutex are
+ * recovered by the kernel in every window.
+ */
+typedef struct{
+  int type;
+  unsigned int nodeCount;
+  volatile unsigned int owner;  //node index + 1 of the holder, 0 when free
+  union{
+    sem_t semaphore;
+    int sysvSemaphoreId;
+    volatile unsigned int futex;
+    struct{
+      volatile unsigned int next;
+      volatile unsigned int serving;
+      volatile unsigned int abandoned;  //tickets of dead waiters not yet skipped
+    }ticket;
+    volatile unsigned int mcsTail;  //node index + 1 of the last waiter, 0 when free
+    pthread_mutex_t mutex;
+  }__attribute__((aligned(CACHE_LINE_SIZE)));
+  sim_lock_node_t nodes[];
+}sim_lock_t;
+
+size_t simLockSize(unsigned int nodeCount);
+
+int simLockType(const char *name);
+
+const char *simLockName(int type);
+
+int simLockInit(sim_lock_t *lock, int type, unsigned int nodeCount, int processShared);
+
+int simLockDestroy(sim_lock_t *lock);
+
+int simLockAcquire(sim_lock_t *lock, unsigned int node);
+
+int simLockRelease(sim_lock_t *lock, unsigned int node);
+
+#define LOCK_RECOVERED_HOLDER 1  //simLockRecover released the lock the dead node held
+#define LOCK_RECOVERED_WAITER 2  //simLockRecover passed over the dead node's place in line
+
+int simLockRecover(sim_lock_t *lock, unsigned int node);
+
+int simLockNodeInLine(sim_lock_t *lock, unsigned int node);
+
+void printSimLockStatistics(sim_lock_t *lock, FILE *stream);
+
+#endif
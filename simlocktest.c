@@ -0,0 +1,101 @@
+/*
+ * simlocktest: regression tests for lock recovery. Each test plays oss and its children with
+ * forked processes sharing one lock, kills a child while it waits in line, recovers its node the
+ * way oss does and checks the waiters behind it still get the lock. Prints one line per test and
+ * exits 1 if any failed.
+ */
+
+#include "simlock.h"
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define TEST_NODES 4
+#define TEST_TIMEOUT_MS 2000
+
+static sim_lock_t *lock;
+
+/*
+ * A child that takes the lock through node once and exits.
+ */
+static pid_t startWaiter(unsigned int node){
+  pid_t pid = fork();
+  if(pid == 0){
+    simLockAcquire(lock, node);
+    simLockRelease(lock, node);
+    _exit(0);
+  }
+  return pid;
+}
+
+/*
+ * Whether node has taken its place in line behind the holder and any earlier waiter.
+ */
+static int waiting(unsigned int node){
+  if(lock->type == LOCK_TICKET) return __atomic_load_n(&lock->nodes[node].ticket, __ATOMIC_SEQ_CST) != 0;
+  return __atomic_load_n(&lock->nodes[node - 1].next, __ATOMIC_SEQ_CST) == node + 1;
+}
+
+static int waitUntil(int (*condition)(unsigned int), unsigned int node){
+  int waited;
+  for(waited = 0; waited < TEST_TIMEOUT_MS && !condition(node); waited++) usleep(1000);
+  return condition(node);
+}
+
+static int finishes(pid_t pid){
+  int waited, status;
+  for(waited = 0; waited < TEST_TIMEOUT_MS; waited++){
+    if(waitpid(pid, &status, WNOHANG) == pid) return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    usleep(1000);
+  }
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+  return 0;
+}
+
+/*
+ * Node 0 holds the lock, nodes 1 and 2 queue behind it, node 1's child is killed and recovered.
+ * Node 1 must stay in line until the lock has passed it, node 2 must then get the lock, and a
+ * new child on node 1 must get it afterwards.
+ */
+static int waiterKilledThenNodeReused(int type){
+  pid_t dead, behind;
+  int ok = 1;
+  if(simLockInit(lock, type, TEST_NODES, 1) == -1) return 0;
+  simLockAcquire(lock, 0);
+  dead = startWaiter(1);
+  ok = ok && waitUntil(waiting, 1);
+  behind = startWaiter(2);
+  ok = ok && waitUntil(waiting, 2);
+  kill(dead, SIGKILL);
+  waitpid(dead, NULL, 0);
+  ok = ok && simLockRecover(lock, 1) == LOCK_RECOVERED_WAITER;
+  ok = ok && simLockNodeInLine(lock, 1);  //oss keeps the slot until this clears
+  simLockRelease(lock, 0);
+  ok = finishes(behind) && ok;
+  ok = ok && !simLockNodeInLine(lock, 1);
+  ok = ok && finishes(startWaiter(1));
+  simLockDestroy(lock);
+  return ok;
+}
+
+int main(int argc, char **argv){
+  int types[] = {LOCK_TICKET, LOCK_MCS};
+  int failed = 0, ok;
+  unsigned int i;
+  lock = mmap(NULL, simLockSize(TEST_NODES), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if(lock == MAP_FAILED){
+    perror("SIMLOCKTEST: Failed to map lock");
+    return 1;
+  }
+  for(i = 0; i < sizeof(types) / sizeof(types[0]); i++){
+    ok = waiterKilledThenNodeReused(types[i]);
+    printf("SIMLOCKTEST: %s waiter killed, then node reused :: %s\n", simLockName(types[i]), ok ? "ok" : "FAILED");
+    failed |= !ok;
+  }
+  munmap(lock, simLockSize(TEST_NODES));
+  return failed;
+}
@@ -18,64 +18,97 @@
  */
 
 #include "simulatedclock.h"
-#include <sys/shm.h>
-#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <sys/types.h>
+#include "futex.h"
+#include <limits.h>
+#include <errno.h>
 
-#define BILLION 1000000000
+#define NO_WAITERS ULLONG_MAX
 
-static int increment = 10000;  //Default is 20 nanoseconds
+static sim_clock_wait_bucket_t *waitBucket(shared_clock_t *sharedClock, unsigned long long nanoseconds){
+  return &sharedClock->buckets[(nanoseconds >> SIM_CLOCK_BUCKET_SHIFT) & (SIM_CLOCK_WAIT_BUCKETS - 1)];
+}
 
-void setSimClockIncrement(int value){
-  increment = value;
+void resetSharedClock(shared_clock_t *sharedClock){
+  int i;
+  setSimClock(&sharedClock->clock, 0);
+  sharedClock->lastWake = 0;
+  sharedClock->scale = 0;
+  sharedClock->origin = 0;
+  for(i = 0; i < SIM_CLOCK_WAIT_BUCKETS; i++){
+    sharedClock->buckets[i].generation = 0;
+    sharedClock->buckets[i].earliest = NO_WAITERS;
+  }
 }
 
-void resetSimClock(sim_clock_t *simClock){
-  simClock->seconds = 0;
-  simClock->nanoseconds = 0;
+/*
+ * Switches the clock to scaled mode. Called by oss before any child starts, with the same origin
+ * for every shard so they all agree on the time.
+ */
+void startScaledSimClock(shared_clock_t *sharedClock, double scale, unsigned long long origin){
+  sharedClock->origin = origin;
+  sharedClock->scale = scale;
 }
 
-void incrementSimClock(sim_clock_t *simClock){
-  if(simClock->nanoseconds + increment >= BILLION){
-    simClock->seconds += 1;
-    simClock->nanoseconds = (simClock->nanoseconds + increment) % BILLION;
+/*
+ * A scaled clock needs no wait list: the deadline maps straight onto a CLOCK_MONOTONIC time.
+ */
+static void scaledSimClockWaitUntil(shared_clock_t *sharedClock, sim_clock_t deadline){
+  unsigned long long wake;
+  struct timespec until;
+  int error;
+  while(simClockNow(sharedClock) < deadline){
+    wake = sharedClock->origin + (unsigned long long)(deadline / sharedClock->scale) + 1;
+    until.tv_sec = wake / SIM_CLOCK_SECOND;
+    until.tv_nsec = wake % SIM_CLOCK_SECOND;
+    if((error = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL)) != 0 && error != EINTR){
+      errno = error;
+      perror("Failed to wait on simulated clock");
+      return;
+    }
   }
-  else simClock->nanoseconds += increment;
 }
 
-int compareSimClocks(sim_clock_t *clock, sim_clock_t *compareTo){
-  if(clock->seconds == compareTo->seconds){
-    if(clock->nanoseconds == compareTo->nanoseconds) return 0;  //clock times are the same
-    if(clock->nanoseconds < compareTo->nanoseconds) return -1;  //clock time is less than
-    return 1;  //clock time is greater
-  }
-  else if(clock->seconds < compareTo->seconds){
-    return -1;  //clock time is less than
+/*
+ * Sleeps until the shared clock reaches deadline. The generation is read before the deadline is
+ * registered, so a wake that consumes the registration always changes the futex word first and
+ * the futex wait returns instead of sleeping.
+ */
+void simClockWaitUntil(shared_clock_t *sharedClock, sim_clock_t deadline){
+  sim_clock_wait_bucket_t *bucket = waitBucket(sharedClock, deadline);
+  if(sharedClock->scale != 0){
+    scaledSimClockWaitUntil(sharedClock, deadline);
+    return;
   }
-  else{
-    return 1;  //clock time is greater than
+  while(1){
+    unsigned int generation = __atomic_load_n(&bucket->generation, __ATOMIC_SEQ_CST);
+    unsigned long long earliest = __atomic_load_n(&bucket->earliest, __ATOMIC_SEQ_CST);
+    while(deadline < earliest && !__atomic_compare_exchange_n(&bucket->earliest, &earliest, deadline, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(readSimClock(&sharedClock->clock) >= deadline) return;
+    if(futexWait(&bucket->generation, generation, NULL) == -1 && errno != EAGAIN && errno != EINTR) perror("Failed to wait on simulated clock");
   }
 }
 
-void addNanosecondsToSimClock(sim_clock_t *destination, sim_clock_t *source, int value){
-    if(value % BILLION == 0){  //value is multiple of 1 second
-      destination->seconds = source->seconds + value/BILLION;
-      destination->nanoseconds = source->nanoseconds;
-    }
-    else if(value + source->nanoseconds < BILLION){  //can add value to nanoseconds without a seconds overflow
-      destination->seconds = source->seconds;
-      destination->nanoseconds = value + source->nanoseconds;
-    }
-    else if(value + source->nanoseconds > BILLION){  //take whole seconds from value and add to seconds, then add remaining to nanoseconds
-      int seconds = floor((source->nanoseconds + value)/BILLION);  
-      destination->seconds = source->seconds + seconds;
-      destination->nanoseconds = (source->nanoseconds + value) - (seconds * BILLION);
-    }
-}
-
-void copySimClock(sim_clock_t *source, sim_clock_t *destination){
-  destination->seconds = source->seconds;
-  destination->nanoseconds = source->nanoseconds;
+/*
+ * Called by oss after advancing the clock. Wakes every bucket between the last call and now whose
+ * earliest deadline has been crossed; a bucket is checked at most once per lap of the wheel.
+ */
+void wakeSimClockWaiters(shared_clock_t *sharedClock){
+  unsigned long long now = sharedClock->clock;
+  unsigned long long first = sharedClock->lastWake >> SIM_CLOCK_BUCKET_SHIFT;
+  unsigned long long last = now >> SIM_CLOCK_BUCKET_SHIFT;
+  unsigned long long i;
+  if(last - first >= SIM_CLOCK_WAIT_BUCKETS) first = last - SIM_CLOCK_WAIT_BUCKETS + 1;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  for(i = first; i <= last; i++){
+    sim_clock_wait_bucket_t *bucket = &sharedClock->buckets[i & (SIM_CLOCK_WAIT_BUCKETS - 1)];
+    if(__atomic_load_n(&bucket->earliest, __ATOMIC_SEQ_CST) > now) continue;
+    __atomic_store_n(&bucket->earliest, NO_WAITERS, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&bucket->generation, 1, __ATOMIC_SEQ_CST);
+    futexWake(&bucket->generation, INT_MAX);
+  }
+  sharedClock->lastWake = now;
 }
@@ -14,21 +14,105 @@
 #ifndef SIMULATEDCLOCK_H
 #define SIMULATEDCLOCK_H
 
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Simulated time in nanoseconds. One 64-bit word, so oss publishes every update with a single
+ * atomic store and readers can never see a torn time; 2^64 ns is over 500 years.
+ */
+typedef uint64_t sim_clock_t;
+
+#define SIM_CLOCK_SECOND 1000000000ULL
+#define SIM_CLOCK_DEFAULT_INCREMENT 10000
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+#define SIM_CLOCK_WAIT_BUCKETS 1024  //must be a power of two
+#define SIM_CLOCK_BUCKET_SHIFT 10  //each bucket spans 2^10 nanoseconds (~1us), so a lap covers about the 1ms child lifetime range
+
+/*
+ * Children sleeping in simClockWaitUntil hash their deadline into a bucket. generation is the
+ * futex word they sleep on; earliest is the smallest deadline (in nanoseconds) waiting there.
+ */
+typedef struct{
+  volatile unsigned int generation;
+  volatile unsigned long long earliest;
+}__attribute__((aligned(CACHE_LINE_SIZE))) sim_clock_wait_bucket_t;
+
+/*
+ * Layout of the shared clock section: the clock itself plus the deadline-bucketed wait list.
+ * lastWake is only touched by oss. A non-zero scale means the clock is not ticked at all: sim
+ * time is scale times the CLOCK_MONOTONIC nanoseconds since origin, and every reader works it out
+ * for itself.
+ */
 typedef struct{
-  int seconds;
-  int nanoseconds;
-}sim_clock_t;
+  volatile sim_clock_t clock;
+  unsigned long long lastWake;
+  double scale;
+  unsigned long long origin;
+  sim_clock_wait_bucket_t buckets[SIM_CLOCK_WAIT_BUCKETS];
+}shared_clock_t;
+
+static inline sim_clock_t readSimClock(const volatile sim_clock_t *clock){
+  return __atomic_load_n(clock, __ATOMIC_ACQUIRE);
+}
+
+static inline void setSimClock(volatile sim_clock_t *clock, sim_clock_t value){
+  __atomic_store_n(clock, value, __ATOMIC_RELEASE);
+}
+
+static inline unsigned long long simClockMonotonic(){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * SIM_CLOCK_SECOND + now.tv_nsec;
+}
+
+/*
+ * The current simulated time, ticked or scaled.
+ */
+static inline sim_clock_t simClockNow(const shared_clock_t *sharedClock){
+  if(sharedClock->scale == 0) return readSimClock(&sharedClock->clock);
+  return (simClockMonotonic() - sharedClock->origin) * sharedClock->scale;
+}
+
+/*
+ * Only oss writes the shared clock, so a plain load and one store is the whole tick.
+ */
+static inline sim_clock_t incrementSimClock(volatile sim_clock_t *clock, sim_clock_t increment){
+  sim_clock_t next = __atomic_load_n(clock, __ATOMIC_RELAXED) + increment;
+  __atomic_store_n(clock, next, __ATOMIC_RELEASE);
+  return next;
+}
+
+static inline sim_clock_t addNanosecondsToSimClock(sim_clock_t clock, uint64_t nanoseconds){
+  return clock + nanoseconds;
+}
+
+/*
+ * -1, 0 or 1 as clock is before, equal to or after compareTo, without branching.
+ */
+static inline int compareSimClocks(sim_clock_t clock, sim_clock_t compareTo){
+  return (clock > compareTo) - (clock < compareTo);
+}
 
-void setSimClockIncrement(int value);
+//seconds and nanoseconds fields of the "%d.%10d" log format
+static inline int simClockSeconds(sim_clock_t clock){
+  return (int)(clock / SIM_CLOCK_SECOND);
+}
 
-void resetSimClock(sim_clock_t *simClock);
+static inline int simClockNanoseconds(sim_clock_t clock){
+  return (int)(clock % SIM_CLOCK_SECOND);
+}
 
-void incrementSimClock(sim_clock_t *simClock);
+void resetSharedClock(shared_clock_t *sharedClock);
 
-int compareSimClocks(sim_clock_t *clock, sim_clock_t *compareTo);
+void startScaledSimClock(shared_clock_t *sharedClock, double scale, unsigned long long origin);
 
-void addNanosecondsToSimClock(sim_clock_t *destination, sim_clock_t *source, int value);
+void simClockWaitUntil(shared_clock_t *sharedClock, sim_clock_t deadline);
 
-void copySimClock(sim_clock_t *source, sim_clock_t *destination);
+void wakeSimClockWaiters(shared_clock_t *sharedClock);
 
 #endif
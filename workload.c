@@ -0,0 +1,160 @@
+#include "workload.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+
+#define WORKLOAD_GOLDEN_GAMMA 0x9e3779b97f4a7c15ULL
+#define WORKLOAD_MAX_SAMPLE 1e15  //keeps a heavy tail inside sim_clock_t
+
+static const char *distributionNames[] = {"none", "fixed", "uniform", "exp", "pareto", "bimodal"};
+static const unsigned int distributionArguments[] = {0, 1, 2, 1, 2, 3};
+
+void initWorkload(workload_t *workload){
+  memset(workload, 0, sizeof(*workload));
+}
+
+/*
+ * "name:arg:arg...", with the argument count fixed by the distribution.
+ */
+static int parseDistribution(distribution_t *distribution, const char *text, size_t length){
+  char buffer[WORKLOAD_SPEC_SIZE];
+  char *argument, *end;
+  double values[3] = {0, 0, 0};
+  unsigned int count = 0;
+  int kind;
+  if(length >= sizeof(buffer)) return -1;
+  memcpy(buffer, text, length);
+  buffer[length] = '\0';
+  if((argument = strchr(buffer, ':')) != NULL) *argument++ = '\0';
+  for(kind = DISTRIBUTION_BIMODAL; kind >= 0 && strcmp(buffer, distributionNames[kind]); kind--);
+  if(kind == -1) return -1;
+  while(argument && *argument){
+    if(count == 3) return -1;
+    values[count++] = strtod(argument, &end);
+    if(end == argument || (*end && *end != ':') || values[count - 1] < 0) return -1;
+    argument = *end ? end + 1 : end;
+  }
+  if(count != distributionArguments[kind]) return -1;
+  if((kind == DISTRIBUTION_UNIFORM && values[1] < values[0]) || (kind == DISTRIBUTION_EXPONENTIAL && values[0] == 0)) return -1;
+  if((kind == DISTRIBUTION_PARETO && (values[0] == 0 || values[1] == 0)) || (kind == DISTRIBUTION_BIMODAL && values[2] > 1)) return -1;
+  distribution->kind = kind;
+  distribution->a = values[0];
+  distribution->b = values[1];
+  distribution->p = values[2];
+  return 0;
+}
+
+/*
+ * Adds a class from "key=value,..." with keys life, hold, gap and weight, e.g.
+ * "life=exp:200000,hold=fixed:2000,gap=uniform:10000:50000,weight=3". Unset keys keep the
+ * original behaviour: a uniform 0-1,000,000 ns life, no hold time and no acquisitions before
+ * the termination.
+ */
+int parseWorkloadClass(workload_t *workload, const char *spec){
+  workload_class_t *class;
+  const char *field = spec, *value, *end;
+  size_t keyLength;
+  if(workload->classCount == WORKLOAD_MAX_CLASSES) return -1;
+  class = &workload->classes[workload->classCount];
+  memset(class, 0, sizeof(*class));
+  class->weight = 1;
+  class->life.kind = DISTRIBUTION_UNIFORM;
+  class->life.b = 1000000;
+  snprintf(class->spec, sizeof(class->spec), "%s", spec);
+  while(*field){
+    if((end = strchr(field, ',')) == NULL) end = field + strlen(field);
+    if((value = memchr(field, '=', end - field)) == NULL) return -1;
+    keyLength = value++ - field;
+    if(keyLength == 4 && strncmp(field, "life", 4) == 0){
+      if(parseDistribution(&class->life, value, end - value) == -1) return -1;
+    }
+    else if(keyLength == 4 && strncmp(field, "hold", 4) == 0){
+      if(parseDistribution(&class->hold, value, end - value) == -1) return -1;
+    }
+    else if(keyLength == 3 && strncmp(field, "gap", 3) == 0){
+      if(parseDistribution(&class->gap, value, end - value) == -1) return -1;
+    }
+    else if(keyLength == 6 && strncmp(field, "weight", 6) == 0){
+      if((class->weight = atoi(value)) == 0) return -1;
+    }
+    else return -1;
+    field = *end ? end + 1 : end;
+  }
+  workload->totalWeight += class->weight;
+  workload->classCount++;
+  return 0;
+}
+
+/*
+ * One class per line; blank lines and lines starting with # are skipped.
+ */
+int loadWorkloadFile(workload_t *workload, const char *path){
+  FILE *file;
+  char line[WORKLOAD_SPEC_SIZE * 2];
+  size_t length;
+  if((file = fopen(path, "r")) == NULL) return -1;
+  while(fgets(line, sizeof(line), file) != NULL){
+    length = strcspn(line, "\r\n");
+    line[length] = '\0';
+    if(length == 0 || line[0] == '#') continue;
+    if(parseWorkloadClass(workload, line) == -1){
+      fprintf(stderr, "Bad workload class `%s'\n", line);
+      fclose(file);
+      errno = EINVAL;
+      return -1;
+    }
+  }
+  fclose(file);
+  return 0;
+}
+
+/*
+ * Without any class given, every child gets the default one.
+ */
+void finishWorkload(workload_t *workload){
+  if(workload->classCount == 0) parseWorkloadClass(workload, "");
+}
+
+/*
+ * splitmix64: small, fast and seekable, so each child's draws can be derived from the run seed
+ * and its spawn index alone.
+ */
+unsigned long long workloadRandom(unsigned long long *state){
+  unsigned long long z = (*state += WORKLOAD_GOLDEN_GAMMA);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/*
+ * Random state for the index'th child started in a run.
+ */
+unsigned long long workloadStream(unsigned long long seed, unsigned int index){
+  return seed + index * WORKLOAD_GOLDEN_GAMMA;
+}
+
+unsigned int pickWorkloadClass(const workload_t *workload, unsigned long long *state){
+  unsigned int i, ticket;
+  if(workload->classCount < 2) return 0;  //leaves the stream alone so single-class runs match older seeds
+  ticket = workloadRandom(state) % workload->totalWeight;
+  for(i = 0; ticket >= workload->classes[i].weight; i++) ticket -= workload->classes[i].weight;
+  return i;
+}
+
+sim_clock_t sampleDistribution(const distribution_t *distribution, unsigned long long *state){
+  double u, value;
+  switch(distribution->kind){
+    case DISTRIBUTION_NONE: return 0;
+    case DISTRIBUTION_FIXED: return distribution->a;
+    case DISTRIBUTION_UNIFORM: return distribution->a + workloadRandom(state) % ((sim_clock_t)(distribution->b - distribution->a) + 1);
+  }
+  u = (workloadRandom(state) >> 11) * 0x1.0p-53;  //[0, 1)
+  switch(distribution->kind){
+    case DISTRIBUTION_EXPONENTIAL: value = -distribution->a * log(1 - u); break;
+    case DISTRIBUTION_PARETO: value = distribution->a / pow(1 - u, 1 / distribution->b); break;
+    default: value = u < distribution->p ? distribution->a : distribution->b;
+  }
+  return value < WORKLOAD_MAX_SAMPLE ? value : WORKLOAD_MAX_SAMPLE;
+}
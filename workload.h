@@ -0,0 +1,62 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include "simulatedclock.h"
+#include <stddef.h>
+
+#define WORKLOAD_MAX_CLASSES 8
+#define WORKLOAD_SPEC_SIZE 128
+
+#define DISTRIBUTION_NONE 0         //always 0; a gap of none means no acquisitions before the termination
+#define DISTRIBUTION_FIXED 1        //fixed:V
+#define DISTRIBUTION_UNIFORM 2      //uniform:MIN:MAX
+#define DISTRIBUTION_EXPONENTIAL 3  //exp:MEAN
+#define DISTRIBUTION_PARETO 4       //pareto:SCALE:SHAPE
+#define DISTRIBUTION_BIMODAL 5      //bimodal:A:B:P, A with probability P and B otherwise
+
+/*
+ * Values are nanoseconds: simulated for lifetimes and gaps, wall-clock for hold times.
+ */
+typedef struct{
+  int kind;
+  double a;
+  double b;
+  double p;
+}distribution_t;
+
+/*
+ * One kind of child. life is how long it lives, hold how long it works inside the critical
+ * section on each acquisition, and gap the simulated time between acquisitions while it lives;
+ * the last acquisition is always the one that sends its termination.
+ */
+typedef struct{
+  unsigned int weight;  //share of spawns that get this class
+  distribution_t life;
+  distribution_t hold;
+  distribution_t gap;
+  char spec[WORKLOAD_SPEC_SIZE];
+}workload_class_t;
+
+typedef struct{
+  unsigned int classCount;
+  unsigned int totalWeight;
+  workload_class_t classes[WORKLOAD_MAX_CLASSES];
+}workload_t;
+
+void initWorkload(workload_t *workload);
+
+int parseWorkloadClass(workload_t *workload, const char *spec);
+
+int loadWorkloadFile(workload_t *workload, const char *path);
+
+void finishWorkload(workload_t *workload);
+
+unsigned long long workloadRandom(unsigned long long *state);
+
+unsigned long long workloadStream(unsigned long long seed, unsigned int index);
+
+unsigned int pickWorkloadClass(const workload_t *workload, unsigned long long *state);
+
+sim_clock_t sampleDistribution(const distribution_t *distribution, unsigned long long *state);
+
+#endif